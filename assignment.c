@@ -3,13 +3,23 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <avr/interrupt.h>
+#include <avr/pgmspace.h>
 
 #include "lcd.h"
 #include "graphics.h"
 #include "cpu_speed.h"
-#include "sprite.h"
 
 #include "usb_serial.h"
+#include "tx_queue.h"
+#include "telemetry.h"
+#include "timer_wheel.h"
+#include "input_log.h"
+#include "input_queue.h"
+#include "debounce.h"
+#include "profile.h"
+#include "rng.h"
+#include "ram.h"
+#include "screen.h"
 
 #include "math.h"
 
@@ -18,8 +28,6 @@
 #define FREQUENCY 8000000.0
 #define PRESCALER 1024.0
 
-#define TWOTOSIXTEEN 65536
-
 #define NUM_BUTTONS 6
 #define BTN_DPAD_LEFT 0
 #define BTN_DPAD_RIGHT 1
@@ -28,85 +36,256 @@
 #define BTN_LEFT 4
 #define BTN_RIGHT 5
 
-#define BTN_STATE_UP 0
-#define BTN_STATE_DOWN 1
-
 #define LINE_LENGTH 5
 
+// Conversions averaged per aim update, and the weight (1/2^n) of each update
+#define ADC_OVERSAMPLE 16
+#define ADC_FILTER_SHIFT 2
+
 #define CRAFT_SPEED 1
 
+// Pool sizes; the entity and timer sets grow to fit (set TIMER_COUNT to match)
+#ifndef BULLET_COUNT
 #define BULLET_COUNT 5
+#endif
+#ifndef ALIEN_COUNT
 #define ALIEN_COUNT 5
+#endif
+
+// Mothership bullets in flight at once, and how many it fires at a time, fanned out
+#define BOSS_BULLET_COUNT 1
+#define BOSS_VOLLEY 1
+#define BOSS_VOLLEY_SPREAD 15
+
+// TIMER4 overflows per second (8 MHz / 128 / 256), the timer wheel's tick
+#define WAIT_TICKS_PER_SECOND 244
+
+// Timer wheel ids
+#define TIMER_MOTHERSHIP_MOVE 0
+#define TIMER_MOTHERSHIP_FIRE 1
+#define TIMER_ALIEN 2	// one per alien, TIMER_ALIEN + i
+#define TIMER_MEMORY (TIMER_ALIEN + ALIEN_COUNT)
+
+#if TIMER_MEMORY >= TIMER_COUNT
+#error "not enough timer wheel ids"
+#endif
+
+// Q8.8 fixed point, used for sprite positions and velocities
+typedef int16_t fixed;
+
+#define FIXED_SHIFT 8
+#define FIXED_ONE (1 << FIXED_SHIFT)
+#define TO_FIXED(v) ((fixed)((v) * FIXED_ONE))
+#define FIXED_TO_INT(f) (((f) + (FIXED_ONE >> 1)) >> FIXED_SHIFT)
+#define FIXED_MUL(a, b) ((fixed)(((int32_t)(a) * (b)) >> FIXED_SHIFT))
 
-#define BULLET_SPEED 1.5
-#define ALIEN_SPEED 0.8
+#define BULLET_SPEED TO_FIXED(1.5)
+#define ALIEN_SPEED TO_FIXED(0.8)
 
-#define MOTHERSHIP_SPEED 0.5;
+#define MOTHERSHIP_SPEED TO_FIXED(0.5)
 
 #define COMPARE_TIMER_SPEED 3906.25 // 0.5s * (FREQUENCY/PRESCALER)
 
-unsigned char bullet[2] = {
-	0b11000000,
+// Fixed simulation rate; the speeds above are per step, not per frame
+#define STEP_HZ 60
+// Steps run before a slow frame gives up and drops the backlog
+#define STEP_MAX 4
+// TIMER1 ticks per second (FREQUENCY/PRESCALER), doubled to stay whole
+#define TICKS_PER_SECOND_X2 15625
+#define STEP_COST ((uint32_t)TICKS_PER_SECOND_X2)
+
+/*
+*	Sprite art, packed MSB first as for the sprite library, in flash. Each
+*	is also pre-shifted into a column-major blit table when compiled.
+*/
+#define BULLET_ART \
+	0b11000000, \
 	0b11000000
-};
 
-unsigned char craft[5] = {
-	0b00100000,
-	0b01110000,
-	0b11111000,
-	0b01110000,
+#define CRAFT_ART \
+	0b00100000, \
+	0b01110000, \
+	0b11111000, \
+	0b01110000, \
 	0b00100000
-};
 
-unsigned char alien[5] = {
-	0b01110000,
-	0b00100000,
-	0b11111000,
-	0b00100000,
+#define ALIEN_ART \
+	0b01110000, \
+	0b00100000, \
+	0b11111000, \
+	0b00100000, \
 	0b01110000
-};
 
-unsigned char mothership[16] = {
-	0b11111111, 0b11000000,
-	0b10011110, 0b01000000,
-	0b10011110, 0b01000000,
-	0b11111111, 0b11000000,
-	0b11011110, 0b11000000,
-	0b11011110, 0b11000000,
-	0b11011110, 0b11000000,
+#define MOTHERSHIP_ART \
+	0b11111111, 0b11000000, \
+	0b10011110, 0b01000000, \
+	0b10011110, 0b01000000, \
+	0b11111111, 0b11000000, \
+	0b11011110, 0b11000000, \
+	0b11011110, 0b11000000, \
+	0b11011110, 0b11000000, \
 	0b11000000, 0b11000000
+
+const unsigned char bullet[2] PROGMEM = { BULLET_ART };
+const unsigned char craft[5] PROGMEM = { CRAFT_ART };
+const unsigned char alien[5] PROGMEM = { ALIEN_ART };
+const unsigned char mothership[16] PROGMEM = { MOTHERSHIP_ART };
+
+const uint16_t bullet_blit[BLIT_OFFSETS][2] PROGMEM = { BLIT_TABLE(BLIT_COLUMNS2, BLIT_NARROW(BULLET_ART)) };
+const uint16_t craft_blit[BLIT_OFFSETS][5] PROGMEM = { BLIT_TABLE(BLIT_COLUMNS5, BLIT_NARROW(CRAFT_ART)) };
+const uint16_t alien_blit[BLIT_OFFSETS][5] PROGMEM = { BLIT_TABLE(BLIT_COLUMNS5, BLIT_NARROW(ALIEN_ART)) };
+const uint16_t mothership_blit[BLIT_OFFSETS][10] PROGMEM = { BLIT_TABLE(BLIT_COLUMNS10, BLIT_WIDE(MOTHERSHIP_ART)) };
+
+/*
+*	Collision mask for a packed bitmap: one word per row, leftmost column in
+*	bit 15, so two sprites overlap on a row when their shifted rows AND
+*	to non-zero. Built once per bitmap by build_mask().
+*/
+#define MASK_ROWS 8
+
+typedef struct {
+	const uint16_t* blit;	// BLIT_OFFSETS x width words in flash
+	unsigned char width, height;
+	uint16_t rows[MASK_ROWS];
+} Mask;
+
+Mask craft_mask;
+Mask alien_mask;
+Mask mothership_mask;
+Mask bullet_mask;
+
+/*
+*	Entity pool. Everything that moves has an id, and each field is its own
+*	array indexed by id, so a loop only pulls in the fields it uses. Each
+*	type owns a fixed run of ids sized by its count above; entity_live holds
+*	one bit per id and live_count the number live per type, so loops visit
+*	only live entities and counts cost nothing. Alien waits run on the timer
+*	wheel, one timer per alien.
+*
+*	Player and mothership bullets share the projectile ids. A projectile's
+*	type is its owner, set when acquire_projectile() takes a free slot, and
+*	each owner is capped at its bullet count.
+*
+*	Positions are Q8.8 with the rounded pixel position (px, py) cached once
+*	per step, so drawing and the collision tests never round. (px, py) to
+*	(right, bottom) is the bounding box, right and bottom exclusive.
+*/
+enum { TYPE_CRAFT, TYPE_ALIEN, TYPE_BULLET, TYPE_MOTHERSHIP, TYPE_BOSS_BULLET, TYPE_COUNT };
+
+#define CRAFT 0
+#define ALIEN(i) (1 + (i))
+#define MOTHERSHIP (1 + ALIEN_COUNT)
+#define PROJECTILE(i) (MOTHERSHIP + 1 + (i))
+#define PROJECTILE_COUNT (BULLET_COUNT + BOSS_BULLET_COUNT)
+#define ENTITY_COUNT PROJECTILE(PROJECTILE_COUNT)
+
+// A set of ids, one bit each, in the narrowest word that holds them all
+#if ENTITY_COUNT <= 16
+typedef uint16_t EntitySet;
+#define ENTITY_CTZ(bits) __builtin_ctz(bits)
+#elif ENTITY_COUNT <= 32
+typedef uint32_t EntitySet;
+#define ENTITY_CTZ(bits) __builtin_ctzl(bits)
+#else
+typedef uint64_t EntitySet;
+#define ENTITY_CTZ(bits) __builtin_ctzll(bits)
+#endif
+
+#if ENTITY_COUNT > 64
+#error "ENTITY_COUNT is over 64; EntitySet has one bit per entity"
+#endif
+
+#define ENTITY_BIT(id) ((EntitySet)1 << (id))
+#define ENTITY_RUN(first, count) ((((EntitySet)1 << (count)) - 1) << (first))
+#define ALIEN_BITS ENTITY_RUN(ALIEN(0), ALIEN_COUNT)
+#define PROJECTILE_BITS ENTITY_RUN(PROJECTILE(0), PROJECTILE_COUNT)
+
+/*
+*	Trig tables in flash. GCC folds sin()/atan() of constants, so these are
+*	generated at compile time and nothing from libm is linked for them.
+*	sin_table holds sin(d) in Q8.8 for whole degrees 0..90; the other three
+*	quadrants come from symmetry. atan_table holds atan(i/32) in whole
+*	degrees for i = 0..32.
+*/
+#define SIN_Q(d) ((fixed)(sin((d) * M_PI / 180) * FIXED_ONE + 0.5))
+#define SIN_Q10(d) SIN_Q(d), SIN_Q(d + 1), SIN_Q(d + 2), SIN_Q(d + 3), SIN_Q(d + 4), \
+	SIN_Q(d + 5), SIN_Q(d + 6), SIN_Q(d + 7), SIN_Q(d + 8), SIN_Q(d + 9)
+
+const fixed sin_table[91] PROGMEM = {
+	SIN_Q10(0), SIN_Q10(10), SIN_Q10(20), SIN_Q10(30), SIN_Q10(40),
+	SIN_Q10(50), SIN_Q10(60), SIN_Q10(70), SIN_Q10(80), SIN_Q(90)
 };
 
-Sprite craft_sprite;
-Sprite bullet_sprite[BULLET_COUNT];
-Sprite alien_sprite[ALIEN_COUNT];
-Sprite mothership_sprite;
-Sprite mothership_bullet;
+#define ATAN_STEPS 32
+#define ATAN_DEG(i) ((unsigned char)(atan((i) / (double)ATAN_STEPS) * 180 / M_PI + 0.5))
+#define ATAN_DEG8(i) ATAN_DEG(i), ATAN_DEG(i + 1), ATAN_DEG(i + 2), ATAN_DEG(i + 3), \
+	ATAN_DEG(i + 4), ATAN_DEG(i + 5), ATAN_DEG(i + 6), ATAN_DEG(i + 7)
 
-double mothership_fire = 0;
-double mothership_wait = -5;
-double alien_wait[ALIEN_COUNT] = {0, 0, 0, 0, 0};
-char on_wall[ALIEN_COUNT] = {0, 0, 0, 0, 0};
-char m_on_wall = 0;
+const unsigned char atan_table[ATAN_STEPS + 1] PROGMEM = {
+	ATAN_DEG8(0), ATAN_DEG8(8), ATAN_DEG8(16), ATAN_DEG8(24), ATAN_DEG(32)
+};
 
-double craft_previous_time = 0;
-double alien_previous_time = 0;
-double bullet_previous_time = 0;
+EntitySet entity_live = 0;
+EntitySet type_live[TYPE_COUNT];
+unsigned char live_count[TYPE_COUNT];
 
-double previous_time = 0;
-double difference = 0;
+unsigned char entity_type[ENTITY_COUNT];
+const Mask* entity_mask[ENTITY_COUNT];
+fixed entity_x[ENTITY_COUNT], entity_y[ENTITY_COUNT];
+fixed entity_dx[ENTITY_COUNT], entity_dy[ENTITY_COUNT];
+int entity_px[ENTITY_COUNT], entity_py[ENTITY_COUNT];
+int entity_right[ENTITY_COUNT], entity_bottom[ENTITY_COUNT];
+char entity_on_wall[ENTITY_COUNT];
+
+/*
+*	Uniform grid over the screen indexing visible aliens by the cell of their
+*	top-left pixel. Each cell heads a singly linked list through alien_next.
+*	Aliens are no wider or taller than a cell, so one can only reach into
+*	the next cell right or down of its own.
+*/
+#define GRID_CELL 8
+#define GRID_W ((LCD_X + GRID_CELL - 1) / GRID_CELL)
+#define GRID_H ((LCD_Y + GRID_CELL - 1) / GRID_CELL)
+#define GRID_NONE 0xFF
+
+unsigned char grid_head[GRID_W * GRID_H];
+unsigned char alien_next[ALIEN_COUNT];
+unsigned char alien_cell[ALIEN_COUNT];
+
+/*
+*	Spawn occupancy. Bit x of row y is set when putting the top-left corner
+*	of the spawning sprite anywhere in that SPAWN_CELL square would overlap a
+*	live entity or land within SPAWN_CRAFT_DISTANCE of the craft. Free cells
+*	are then counted and one picked uniformly, so placement is bounded.
+*/
+#define SPAWN_CELL 4
+#define SPAWN_COLS ((LCD_X + SPAWN_CELL - 1) / SPAWN_CELL)
+#define SPAWN_ROWS ((LCD_Y + SPAWN_CELL - 1) / SPAWN_CELL)
+#define SPAWN_CRAFT_DISTANCE 16
+
+#if SPAWN_COLS > 32
+#error "spawn_cells rows hold at most 32 cells"
+#endif
+
+uint32_t spawn_cells[SPAWN_ROWS];
+
+// TIMER1 count at the last frame, and elapsed ticks * 2 * STEP_HZ not yet simulated
+uint16_t step_previous_tick = 0;
+uint32_t step_accumulator = 0;
 
 int mothership_lives = 10;
 int speed = 0;
 int aim_x, aim_y;
-double sp_count = 0;
+int sp_count = 0;
 
 char boss_time = 1;
 
 void shoot(int degrees);
-void send_line(char* string);
-void send_debug_string(char* string);
-double get_global_time();
+void send_event(uint8_t event, const void* payload, uint8_t size);
+void arm_alien(int alien);
+void arm_mothership_move();
+void arm_mothership_fire();
+uint32_t get_global_ticks();
 
 /* 	
 	0: BTN_DPAD_LEFT 	1: BTN_DPAD_RIGHT 
@@ -121,21 +300,89 @@ int lives = 3;
 int seconds = 0;
 int minutes = 0;
 
+// What the status row last showed; status_drawn is cleared whenever the screen is
+char status_drawn = 0;
+int shown_seconds, shown_minutes, shown_lives, shown_score;
+
 char gameRunning = 0;
 
 int press_count;
 unsigned long overflow_count;
-int debug_overflow_count = 0;
+volatile uint16_t debug_overflow_count = 0;
+
+// Collision pairs reaching the broad phase, and how many it threw out
+unsigned long pairs_tested = 0;
+unsigned long pairs_rejected = 0;
+// The counts as of the last step, copied whole for the status ISR
+volatile uint32_t pairs_reported[2];
 char buff[BUFF_LENGTH];
 
-volatile unsigned char btn_hists[NUM_BUTTONS];
-volatile unsigned char btn_held[NUM_BUTTONS];
+/*
+*	Written by the ADC ISR: the latest raw conversion, and the aim in degrees
+*	from an exponential filter over ADC_OVERSAMPLE-sample sums. adc_filter
+*	settles at ADC_OVERSAMPLE times the pot reading.
+*/
+volatile uint16_t adc_latest = 0;
+volatile int aim_degrees = 0;
+uint16_t adc_filter = 0;
+uint16_t adc_sum = 0;
+unsigned char adc_samples = 0;
+
+// Owned by TIMER4; buttons_down is its debounced state, a bit per button
+Debouncer debouncer;
+volatile uint8_t buttons_down = 0;
+
+// Buttons down as of the last event read_inputs() took from input_queue
+uint8_t buttons_held = 0;
+
+// This game's presses and shots, from the first sample that saw the
+// button change to the step that took the event, in TIMER4 ticks
+uint16_t latency_count;
+uint16_t latency_min, latency_max;
+uint32_t latency_sum;
+
+/*
+*	What the current step runs on, sampled once by read_inputs(). Every
+*	step's inputs and each game's seed are logged through input_recorder
+*	and sent as EVENT_INPUT frames, record_buffer bytes at a time; with
+*	INPUT_REPLAY a log can be fed back in place of the live inputs.
+*	record_buffer[0] numbers the frame, so a frame the serial queue drops
+*	shows up as a gap rather than a silently corrupt log; each game's seed
+*	opens a fresh frame flagged INPUT_GAME_START, where a capture can begin.
+*/
+InputFrame input;
+InputRecorder input_recorder;
+uint8_t record_buffer[TELEMETRY_PAYLOAD_MAX];
+uint8_t record_length = 1;
+uint8_t record_sequence = 0;
+uint8_t record_game_start = 0;
+uint32_t step_count = 0;
+
+#ifdef INPUT_REPLAY
+InputPlayer input_player;
+char input_replaying = 0;
+// When set, games are seeded seed_next, seed_next + 1, ... not from the clock
+char seed_given = 0;
+uint16_t seed_next = 0;
+#endif
 
 void init_sprites();
-double angle_to(double x2, double y2, double x1, double y1);
-char alien_collided_craft(int i);
-char craft_collided_alien();
-char has_collided_sprite(Sprite* sprite, Sprite* spr);
+void ADC_start();
+int get_aim();
+int angle_to(int x1, int y1, int x2, int y2);
+fixed sin_deg(int degrees);
+fixed cos_deg(int degrees);
+void place_spawn(unsigned char id, int x_max, int y_max, EntitySet avoid, char far_from_craft);
+int alien_collided(unsigned char id);
+void grid_clear();
+void grid_update(int alien);
+char has_collided_sprite(unsigned char a, unsigned char b);
+void place_entity(unsigned char id, int x, int y);
+char is_live(unsigned char id);
+void spawn(unsigned char id);
+void despawn(unsigned char id);
+int acquire_projectile(unsigned char type, unsigned char cap);
+void launch_projectile(unsigned char id, int x, int y, int degrees);
 
 void init_hardware(){
 
@@ -152,6 +399,8 @@ void init_hardware(){
 	//set prescaler
 	ADCSRA |= (1<<2)|(1<<1)|1;
 
+	ADC_start();
+
 	// Init Buttons as input
 	DDRF &= ~((1 << PF5) | (1 << PF6));
 	DDRD &= ~((1 << PD1) | (1 << PD0));
@@ -210,71 +459,28 @@ void init_hardware(){
 
 }
 
-/*  
-*	CAB202 Tutorial 10 (Question 2_3)
-*	B.Talbot, September 2015
-*	Queensland University of Technology
-*/
-void send_debug_string(char* string) {
-	// Send the debug preamble...
-	sprintf(buff, "[DEBUG @ %03.03f] ;", (double)get_global_time());
-	//usb_serial_write(buff, 18);
-
-	// Send all of the characters in the string
-
-	for(int i = 0; i < BUFF_LENGTH; i++){
-		if(buff[i] == ';') break;
-		usb_serial_putchar(buff[i]);
-	}
-
-	unsigned char char_count = 0;
-	while (*string != '\0') {
-		usb_serial_putchar(*string);
-		string++;
-		char_count++;
-	}
-
-	// Go to a new line (force this to be the start of the line)
-	usb_serial_putchar('\r');
-	usb_serial_putchar('\n');
- }
+// Timestamped binary event, decoded back to text by host/decode
+void send_event(uint8_t event, const void* payload, uint8_t size) {
+	telemetry_send(get_global_ticks(), event, payload, size);
+}
 
 void materialise_spaceship(){
-	craft_sprite.is_visible = 1;
-
-	craft_sprite.x = rand() % (LCD_X - 7) + 1;
-	craft_sprite.y = rand() % (LCD_Y - 16) + 10;
-
-	while(craft_collided_alien()){
-		craft_sprite.x = rand() % (LCD_X - 7) + 1;
-		craft_sprite.y = rand() % (LCD_Y - 16) + 10;
-	}
+	spawn(CRAFT);
+	place_spawn(CRAFT, LCD_X - 7, LCD_Y - 7, ALIEN_BITS | ENTITY_BIT(MOTHERSHIP), 0);
 }
 
 char aliens_dead(){
-	for (int i = 0; i < ALIEN_COUNT; i++){
-		if(alien_sprite[i].is_visible){
-			return 0;
-		}
-	}
-	return 1;
+	return live_count[TYPE_ALIEN] == 0;
 }
 
 void materialise_alien(int alien){
-	alien_sprite[alien].is_visible = 1;
-	double ok = -((double)((rand() % 200) + 200)/100.0);
-	alien_sprite[alien].dx = 0;
-	alien_sprite[alien].dy = 0;
-	alien_wait[alien] = ok;
-	alien_sprite[alien].x = rand() % (LCD_X - 7) + 1;
-	alien_sprite[alien].y = rand() % (LCD_Y - 16) + 10;
-	while(alien_collided_craft(alien)){
-		alien_sprite[alien].x = rand() % (LCD_X - 7) + 1;
-		alien_sprite[alien].y = rand() % (LCD_Y - 16) + 10;
-	}
-
-	//sprintf(buff, "%f", alien_wait[alien]);
-	//send_line(buff);
+	unsigned char id = ALIEN(alien);
+	spawn(id);
+	entity_dx[id] = 0;
+	entity_dy[id] = 0;
+	arm_alien(alien);
+	place_spawn(id, LCD_X - 7, LCD_Y - 7, ALIEN_BITS | ENTITY_BIT(CRAFT), 1);
+	grid_update(alien);
 
 }
 
@@ -283,43 +489,34 @@ void materialise_aliens(){
 		materialise_alien(i);
 	}
 
-	/* sprintf(aff, "Hello %f:%f:%f:%f:%f", alien_wait[0], alien_wait[1], alien_wait[2], alien_wait[3], alien_wait[4]);
-	send_line(aff); */
-
 }
 
 void materialise_boss(){
-	mothership_sprite.is_visible = 1;
-	mothership_sprite.dx = 0;
-	mothership_sprite.dy = 0;
-	mothership_wait = -((double)((rand() % 200) + 200)/100.0);
-	mothership_fire = -((double)((rand() % 200) + 200)/100.0);
-	mothership_sprite.x = rand() % (LCD_X - 11) + 1;
-	mothership_sprite.y = rand() % (LCD_Y - 18) + 10;
-	while(has_collided_sprite(&mothership_sprite, &craft_sprite)){
-		mothership_sprite.x = rand() % (LCD_X - 11) + 1;
-		mothership_sprite.y = rand() % (LCD_Y - 19) + 10;
-	}
+	spawn(MOTHERSHIP);
+	entity_dx[MOTHERSHIP] = 0;
+	entity_dy[MOTHERSHIP] = 0;
+	arm_mothership_move();
+	arm_mothership_fire();
+	place_spawn(MOTHERSHIP, LCD_X - 11, LCD_Y - 9, ALIEN_BITS | ENTITY_BIT(CRAFT), 1);
 }
 
 void draw_boss_health(){
-	if(mothership_sprite.y > 12){
-		draw_line(mothership_sprite.x, mothership_sprite.y - 2, mothership_sprite.x + mothership_lives - 1, mothership_sprite.y - 2);
-	}
-	else{
-		draw_line(mothership_sprite.x, mothership_sprite.y + 10, mothership_sprite.x + mothership_lives - 1, mothership_sprite.y + 10);
-	}
+	int x = entity_px[MOTHERSHIP];
+	int y = entity_py[MOTHERSHIP] > 12 ? entity_py[MOTHERSHIP] - 2 : entity_py[MOTHERSHIP] + 10;
+	draw_line(x, y, x + mothership_lives - 1, y);
+	mark_drawn(x, y, x + mothership_lives - 1, y);
 }
 
 void boss_shoot(){
-	double angle = angle_to(mothership_sprite.x + 5, mothership_sprite.y + 4, craft_sprite.x + 2, craft_sprite.y + 2);
-	if(!mothership_bullet.is_visible){
-		mothership_bullet.is_visible = 1;
-		mothership_bullet.x = mothership_sprite.x + 5;
-		mothership_bullet.y = mothership_sprite.y + 4;
-		mothership_bullet.dx = cos(angle) * BULLET_SPEED;
-		mothership_bullet.dy = sin(angle) * BULLET_SPEED;
-		mothership_fire = -((double)((rand() % 200) + 200)/100.0);
+	int x = entity_px[MOTHERSHIP] + 5;
+	int y = entity_py[MOTHERSHIP] + 4;
+	int angle = angle_to(x, y, entity_px[CRAFT] + 2, entity_py[CRAFT] + 2);
+
+	angle -= (BOSS_VOLLEY - 1) * BOSS_VOLLEY_SPREAD / 2;
+	for(int i = 0; i < BOSS_VOLLEY; i++, angle += BOSS_VOLLEY_SPREAD){
+		int id = acquire_projectile(TYPE_BOSS_BULLET, BOSS_BULLET_COUNT);
+		if(id < 0) return;
+		launch_projectile(id, x, y, angle);
 	}
 }
 
@@ -327,6 +524,15 @@ void boss_battle(){
 	materialise_boss();
 }
 
+// Runs in the main loop, so the ISR never reads a half-written count
+void publish_pairs(){
+	uint8_t sreg = SREG;
+	cli();
+	pairs_reported[0] = pairs_tested;
+	pairs_reported[1] = pairs_rejected;
+	SREG = sreg;
+}
+
 void init_variables(){
 
 	pre_press = 0;
@@ -334,44 +540,143 @@ void init_variables(){
 	overflow_count = 0;
 	score = 0;
 	lives = 3;
+	mothership_lives = 10;
 	TCNT0 = 0;
 	seconds = 0;
 	minutes = 0;
 
 	boss_time = 1;
 
-	previous_time = 0;
+	pairs_tested = 0;
+	pairs_rejected = 0;
+	publish_pairs();
+
+	uint8_t sreg = SREG;
+	cli();
+	debouncer = (Debouncer){ 0 };
+	buttons_down = 0;
+	SREG = sreg;
+
+	latency_count = 0;
+	latency_min = 0xFFFF;
+	latency_max = 0;
+	latency_sum = 0;
+	step_count = 0;
+}
 
-	for (int i = 0; i < NUM_BUTTONS; i++){
-		btn_held[i] = 0;
-		btn_hists[i] = 0;
+void send_status(){
+	int16_t status[4] = { entity_px[CRAFT], entity_py[CRAFT], get_aim(), speed };
+	send_event(EVENT_STATUS, status, sizeof(status));
+
+	uint32_t pairs[2] = { pairs_reported[0], pairs_reported[1] };
+	send_event(EVENT_COLLISION_PAIRS, pairs, sizeof(pairs));
+
+	if(tx_queue_overflows){
+		uint16_t drops[2] = { tx_queue_overflows, tx_queue_dropped };
+		send_event(EVENT_SERIAL_DROPS, drops, sizeof(drops));
 	}
 }
 
-void send_status(){
-	char aff[80];
-	sprintf(aff, "Location: ( %d, %d) Aim: %d",(int)(craft_sprite.x), (int)(craft_sprite.y), (int)((ADC * 0.705)));
-	send_debug_string(aff);
+// Sprites are at most 16 pixels wide and MASK_ROWS tall
+void build_mask(Mask* mask, const unsigned char* bitmap, const uint16_t* blit, unsigned char width, unsigned char height){
+	unsigned char byte_width = (width + 7) / 8;
+	uint16_t solid = 0xFFFF << (16 - width);
+
+	mask->blit = blit;
+	mask->width = width;
+	mask->height = height;
+	for (int row = 0; row < height; row++){
+		uint16_t bits = pgm_read_byte(&bitmap[row * byte_width]) << 8;
+		if (byte_width > 1) bits |= pgm_read_byte(&bitmap[row * byte_width + 1]);
+		mask->rows[row] = bits & solid;
+	}
+}
+
+void init_entity(unsigned char id, unsigned char type, const Mask* mask){
+	entity_type[id] = type;
+	entity_mask[id] = mask;
+	entity_dx[id] = 0;
+	entity_dy[id] = 0;
+	entity_on_wall[id] = 0;
+	place_entity(id, 0, 0);
+}
+
+char is_live(unsigned char id){
+	return (entity_live & ENTITY_BIT(id)) != 0;
+}
+
+void spawn(unsigned char id){
+	if(is_live(id)) return;
+	entity_live |= ENTITY_BIT(id);
+	type_live[entity_type[id]] |= ENTITY_BIT(id);
+	live_count[entity_type[id]]++;
+}
+
+void despawn(unsigned char id){
+	if(!is_live(id)) return;
+	entity_live &= ~ENTITY_BIT(id);
+	type_live[entity_type[id]] &= ~ENTITY_BIT(id);
+	live_count[entity_type[id]]--;
+}
+
+// Takes the lowest id out of a set of live bits
+unsigned char next_live(EntitySet* bits){
+	unsigned char id = ENTITY_CTZ(*bits);
+	*bits &= *bits - 1;
+	return id;
+}
+
+// Spawns a free projectile for owner type, unless it already has cap live; -1 if none
+int acquire_projectile(unsigned char type, unsigned char cap){
+	EntitySet idle = ~entity_live & PROJECTILE_BITS;
+	if(!idle || live_count[type] >= cap) return -1;
+
+	unsigned char id = next_live(&idle);
+	entity_type[id] = type;
+	spawn(id);
+	return id;
+}
+
+void launch_projectile(unsigned char id, int x, int y, int degrees){
+	place_entity(id, x, y);
+	entity_dx[id] = FIXED_MUL(cos_deg(degrees), BULLET_SPEED);
+	entity_dy[id] = FIXED_MUL(sin_deg(degrees), BULLET_SPEED);
 }
 
 void init_sprites(){
-	init_sprite(&craft_sprite, 0, 0, 5, 5, craft);
-	craft_sprite.is_visible = 0;
-	init_sprite(&mothership_sprite, 0, 0, 10, 8, mothership);
-	mothership_sprite.is_visible = 0;
-	init_sprite(&mothership_bullet, 0, 0, 2, 2, bullet);
-	mothership_bullet.is_visible = 0;
+	build_mask(&craft_mask, craft, craft_blit[0], 5, 5);
+	build_mask(&alien_mask, alien, alien_blit[0], 5, 5);
+	build_mask(&mothership_mask, mothership, mothership_blit[0], 10, 8);
+	build_mask(&bullet_mask, bullet, bullet_blit[0], 2, 2);
+
+	entity_live = 0;
+	for(int t = 0; t < TYPE_COUNT; t++){
+		type_live[t] = 0;
+		live_count[t] = 0;
+	}
 
+	init_entity(CRAFT, TYPE_CRAFT, &craft_mask);
+	init_entity(MOTHERSHIP, TYPE_MOTHERSHIP, &mothership_mask);
 	for(int i = 0; i < ALIEN_COUNT; i++){
-		init_sprite(&alien_sprite[i], 0, 40, 5, 5, alien);
-		alien_sprite[i].is_visible = 0;
-		init_sprite(&bullet_sprite[i], 0, 20, 2, 2, bullet);
-		bullet_sprite[i].is_visible = 0;
+		init_entity(ALIEN(i), TYPE_ALIEN, &alien_mask);
 	}
+	for(int i = 0; i < PROJECTILE_COUNT; i++){
+		init_entity(PROJECTILE(i), TYPE_BULLET, &bullet_mask);
+	}
+	grid_clear();
 }
 
-double get_global_time() {
-	return (PRESCALER / FREQUENCY) * (TCNT1 + (debug_overflow_count * TWOTOSIXTEEN));
+// TIMER1 ticks since power on, for event timestamps
+uint32_t get_global_ticks() {
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t low = TCNT1;
+	uint32_t high = debug_overflow_count;
+
+	// Overflowed since interrupts went off, but not yet counted
+	if ((TIFR1 & (1 << TOV1)) && low < 0x8000) high++;
+	SREG = sreg;
+	return high << 16 | low;
 }
 
 double get_system_time() {
@@ -382,7 +687,7 @@ void wait_for_press(){
 	pre_press = press_count;
 	while(1){
 		show_screen();
-		if (btn_held[BTN_LEFT] || btn_held[BTN_RIGHT]){
+		if (buttons_down & (1 << BTN_LEFT | 1 << BTN_RIGHT)){
 			break;
 		}
 	}
@@ -396,43 +701,59 @@ void process_time(){
 
 void intro_menu(){
 	clear_screen();
-	draw_string(1, 0, "Alien Advance");
-	draw_string(1, 8, "Bennett Hardwick");
-	draw_string(1, 16, "n9803572");
-	draw_string(1, 24, "Press a button");
-	draw_string(1, 32, "to continue...");
+	draw_string_P(1, 0, PSTR("Alien Advance"));
+	draw_string_P(1, 8, PSTR("Bennett Hardwick"));
+	draw_string_P(1, 16, PSTR("n9803572"));
+	draw_string_P(1, 24, PSTR("Press a button"));
+	draw_string_P(1, 32, PSTR("to continue..."));
 	show_screen();
 	wait_for_press();
 
-	draw_string((LCD_X - 1)/2, 40, "3");
+	draw_string_P((LCD_X - 1)/2, 40, PSTR("3"));
 	show_screen();
 	_delay_ms(300);
-	draw_string((LCD_X - 1)/2, 40, "2");
+	draw_string_P((LCD_X - 1)/2, 40, PSTR("2"));
 	show_screen();
 	_delay_ms(300);
-	draw_string((LCD_X - 1)/2, 40, "1");
+	draw_string_P((LCD_X - 1)/2, 40, PSTR("1"));
 	show_screen();
 	_delay_ms(300);
 }
 
 void draw_status_border(){
 
-	// this is status
-
-	sprintf(buff, "T:%02d:%02d L:%d S:%d", minutes, seconds, lives, score);
-	draw_string(0, 0, buff);
+	// frames per second, sampled as the clock ticks over
 
-	if(fmod(get_system_time(), 1) == 0.0){
+	sp_count++;
+	if(status_drawn && seconds != shown_seconds){
 		speed = sp_count;
 		sp_count = 0;
 	}
 
+	if(status_drawn && seconds == shown_seconds && minutes == shown_minutes
+		&& lives == shown_lives && score == shown_score) return;
+
 	// draw border
 
-	draw_line(0, 9, LCD_X - 1, 9);
-	draw_line(LCD_X - 1, 9, LCD_X - 1, LCD_Y - 1);
-	draw_line(LCD_X - 1, LCD_Y - 1, 0, LCD_Y - 1);
-	draw_line(0, LCD_Y - 1, 0, 9);
+	if(!status_drawn){
+		draw_line(0, 9, LCD_X - 1, 9);
+		draw_line(LCD_X - 1, 9, LCD_X - 1, LCD_Y - 1);
+		draw_line(LCD_X - 1, LCD_Y - 1, 0, LCD_Y - 1);
+		draw_line(0, LCD_Y - 1, 0, 9);
+		mark_dirty(0, 9, LCD_X - 1, LCD_Y - 1);
+	}
+
+	// this is status
+
+	sprintf_P(buff, PSTR("T:%02d:%02d L:%d S:%d"), minutes, seconds, lives, score);
+	clear_rect(0, 0, LCD_X - 1, 7);
+	draw_string(0, 0, buff);
+
+	status_drawn = 1;
+	shown_seconds = seconds;
+	shown_minutes = minutes;
+	shown_lives = lives;
+	shown_score = score;
 }	
 
 void clear_game_screen(){
@@ -443,296 +764,665 @@ void clear_game_screen(){
 	}
 }
 
-void draw_aim_line(int degrees){
-	double radians = degrees * M_PI / 180;
-	int x = craft_sprite.x + 2;
-	int y = craft_sprite.y + 2;
+// End of the aim line from the craft's centre, pulled in to stay on screen; bullets start here
+void aim_end(int degrees, int* end_x, int* end_y){
+	fixed cos_a = cos_deg(degrees);
+	fixed sin_a = sin_deg(degrees);
+	int x = entity_px[CRAFT] + 2;
+	int y = entity_py[CRAFT] + 2;
 	int pixel_length = LINE_LENGTH;
 
-	aim_x = x + cos(radians) * LINE_LENGTH;
-	aim_y = y + sin(radians) * LINE_LENGTH;
-	while(!(aim_x < LCD_X && aim_x > 0)){
+	// Division truncates toward zero, as the old double-to-int conversion did
+	*end_x = x + cos_a * LINE_LENGTH / FIXED_ONE;
+	*end_y = y + sin_a * LINE_LENGTH / FIXED_ONE;
+	while(!(*end_x < LCD_X && *end_x > 0)){
 		pixel_length--;
-		aim_x = x + cos(radians) * pixel_length;
+		*end_x = x + cos_a * pixel_length / FIXED_ONE;
 	}
-	while(!(aim_y < LCD_Y && aim_y > 8)){
+	while(!(*end_y < LCD_Y && *end_y > 8)){
 		pixel_length--;
-		aim_y = y + sin(radians) * pixel_length;
+		*end_y = y + sin_a * pixel_length / FIXED_ONE;
 	}
-	draw_line(x, y, aim_x, aim_y);
+}
+
+void draw_aim_line(int degrees){
+	int x = entity_px[CRAFT] + 2;
+	int y = entity_py[CRAFT] + 2;
+	int end_x, end_y;
+
+	aim_end(degrees, &end_x, &end_y);
+	draw_line(x, y, end_x, end_y);
+	mark_drawn(x < end_x ? x : end_x, y < end_y ? y : end_y, x > end_x ? x : end_x, y > end_y ? y : end_y);
 }
 
 // Taken from tutorial code (TUT10)
 //	B.Talbot, September 2015
 //	Queensland University of Technology
-void draw_centred(unsigned char y, char* string) {
-	// Draw a string centred in the LCD when you don't know the string length
-	unsigned char l = 0, i = 0;
-	while (string[i] != '\0') {
-		l++;
-		i++;
-	}
+void draw_centred_P(unsigned char y, const char* string) {
+	// Draw a flash string centred in the LCD when you don't know the string length
+	unsigned char l = strlen_P(string);
 	char x = 42-(l*5/2);
-	draw_string((x > 0) ? x : 0, y, string);
+	draw_string_P((x > 0) ? x : 0, y, string);
 }
 
-void send_line(char* string) {
-    // Send all of the characters in the string
-    unsigned char char_count = 0;
-    while (*string != '\0') {
-        usb_serial_putchar(*string);
-        string++;
-        char_count++;
-    }
+// Refresh the cached pixel position; returns 1 if it changed
+char sync_entity( unsigned char id ) {
+	int x1 = FIXED_TO_INT( entity_x[id] );
+	int y1 = FIXED_TO_INT( entity_y[id] );
+	if ( x1 == entity_px[id] && y1 == entity_py[id] ) return 0;
+	entity_px[id] = x1;
+	entity_py[id] = y1;
+	entity_right[id] = x1 + entity_mask[id]->width;
+	entity_bottom[id] = y1 + entity_mask[id]->height;
+	return 1;
+}
 
-    // Go to a new line (force this to be the start of the line)
-    usb_serial_putchar('\r');
-    usb_serial_putchar('\n');
+void place_entity( unsigned char id, int x, int y ) {
+	entity_x[id] = x << FIXED_SHIFT;
+	entity_y[id] = y << FIXED_SHIFT;
+	entity_px[id] = x;
+	entity_py[id] = y;
+	entity_right[id] = x + entity_mask[id]->width;
+	entity_bottom[id] = y + entity_mask[id]->height;
 }
 
 // Modified version from the CAB202 Assignment 1 graphics library
 //	B.Talbot, September 2015
 //	Queensland University of Technology
-char sprite_step( Sprite *sprite ) {
-	int x0 = round( sprite->x );
-	int y0 = round( sprite->y );
-	sprite->x += sprite->dx;
-	sprite->y += sprite->dy;
-	int x1 = round( sprite->x );
-	int y1 = round( sprite->y );
-	return ( x1 != x0 ) || ( y1 != y0 );
-}
-
-char sprite_move( Sprite *sprite, double dx, double dy ) {
-	int x0 = round( sprite->x );
-	int y0 = round( sprite->y );
-	sprite->x += dx;
-	sprite->y += dy;
-	int x1 = round( sprite->x );
-	int y1 = round( sprite->y );
-	return ( x1 != x0 ) || ( y1 != y0 );
-}
-
-void ADC_prep(){
+char sprite_step( unsigned char id ) {
+	entity_x[id] += entity_dx[id];
+	entity_y[id] += entity_dy[id];
+	return sync_entity( id );
+}
+
+char sprite_move( unsigned char id, fixed dx, fixed dy ) {
+	entity_x[id] += dx;
+	entity_y[id] += dy;
+	return sync_entity( id );
+}
+
+// Free-running conversions of ADC1 (the aim pot), each one raising ADC_vect
+void ADC_start(){
 	ADMUX &= ~((1<<MUX4)|(1<<MUX3)|(1<<MUX2)|(1<<MUX1));
 	ADMUX |= (1<<MUX0);
+	ADCSRB &= ~((1<<MUX5)|(1<<ADTS3)|(1<<ADTS2)|(1<<ADTS1)|(1<<ADTS0));
+	ADCSRA |= (1<<ADATE)|(1<<ADIE);
 	ADCSRA |= 1<<ADSC;
-	// Wait for transfer
-	while((ADCSRA>>ADSC)&1);
 }
 
-void process_input(){
+// Latest filtered aim; the ISR may be halfway through writing it
+int get_aim(){
+	uint8_t sreg = SREG;
+	cli();
+	int aim = aim_degrees;
+	SREG = sreg;
+	return aim;
+}
 
-	char a = usb_serial_getchar();
+void process_input(){
 
-	//double timing = get_system_time() - craft_previous_time;
+	char a = input.serial;
 
-	if ((a == 'a' || btn_held[BTN_DPAD_LEFT]) && (craft_sprite.x > 1) ) craft_sprite.x += -(CRAFT_SPEED);
-	if ((a == 'd' || btn_held[BTN_DPAD_RIGHT]) && (craft_sprite.x < LCD_X - 6) ) craft_sprite.x += (CRAFT_SPEED);
-	if ((a == 'w' || btn_held[BTN_DPAD_UP]) && (craft_sprite.y > 10) ) craft_sprite.y += -(CRAFT_SPEED);
-	if ((a == 's' || btn_held[BTN_DPAD_DOWN]) && (craft_sprite.y < LCD_Y - 6) ) craft_sprite.y += (CRAFT_SPEED);
-	if ((a == ' ')) shoot(ADC * 0.705);
+	if ((a == 'a' || input.buttons & 1 << BTN_DPAD_LEFT) && (entity_px[CRAFT] > 1) ) sprite_move(CRAFT, -TO_FIXED(CRAFT_SPEED), 0);
+	if ((a == 'd' || input.buttons & 1 << BTN_DPAD_RIGHT) && (entity_px[CRAFT] < LCD_X - 6) ) sprite_move(CRAFT, TO_FIXED(CRAFT_SPEED), 0);
+	if ((a == 'w' || input.buttons & 1 << BTN_DPAD_UP) && (entity_py[CRAFT] > 10) ) sprite_move(CRAFT, 0, -TO_FIXED(CRAFT_SPEED));
+	if ((a == 's' || input.buttons & 1 << BTN_DPAD_DOWN) && (entity_py[CRAFT] < LCD_Y - 6) ) sprite_move(CRAFT, 0, TO_FIXED(CRAFT_SPEED));
 
-	//craft_previous_time = get_system_time();
+	aim_end(input.aim, &aim_x, &aim_y);
+	if ((a == ' ')) shoot(input.aim);
+	for (uint8_t i = 0; i < input.fires; i++) shoot(input.aim);
 	a = 0;
 }
 
-char has_collided_coords( Sprite* sprite, int x_s, int y_s){
-	int x = (int) round( sprite->x );
-	int y = (int) round( sprite->y );
-	int offset = 0;
+// Recorded input goes out as EVENT_INPUT frames once a payload's worth is buffered
+void flush_record(){
+	if(record_length == 1) return;
+	record_buffer[0] = (record_sequence++ & INPUT_SEQUENCE_MASK) | record_game_start;
+	record_game_start = 0;
+	send_event(EVENT_INPUT, record_buffer, record_length);
+	record_length = 1;
+}
 
-	for ( int row = 0; row < sprite->height; row++ ) {
-		for ( int col = 0; col < sprite->width; col++ ) {
-			char ch = sprite->bitmap[offset++] & 0xff;
-			if ( ch != ' ' ) {
-				if( x + col == x_s && y + row == y_s) return 1;
-			}
+void record_bytes(const uint8_t* bytes, uint8_t size){
+	while(size--){
+		record_buffer[record_length++] = *bytes++;
+		if(record_length == TELEMETRY_PAYLOAD_MAX) flush_record();
+	}
+}
+
+// Seeds a game from the clock, or from the log when replaying, and logs it
+uint16_t game_seed(){
+	uint16_t seed = TCNT1;
+	uint8_t bytes[INPUT_RECORD_MAX];
+
+#ifdef INPUT_REPLAY
+	if(seed_given) seed = seed_next++;
+	if(input_replaying) input_play_seed(&input_player, &seed);
+#endif
+	// Close off the last game so the seed starts a frame of its own
+	record_bytes(bytes, input_record_flush(&input_recorder, bytes));
+	flush_record();
+	record_game_start = INPUT_GAME_START;
+	record_bytes(bytes, input_record_seed(&input_recorder, seed, bytes));
+	return seed;
+}
+
+// elapsed is ticks from queueing to now; the debouncer saw the change
+// DEBOUNCE_DEPTH - 1 samples before it queued the event
+void note_latency(uint16_t elapsed){
+	uint16_t ticks = elapsed + DEBOUNCE_DEPTH - 1;
+	latency_count++;
+	latency_sum += ticks;
+	if(ticks < latency_min) latency_min = ticks;
+	if(ticks > latency_max) latency_max = ticks;
+}
+
+void report_latency(){
+	if(!latency_count) return;
+	uint16_t latency[4] = { latency_count, latency_min, latency_sum / latency_count, latency_max };
+	send_event(EVENT_LATENCY, latency, sizeof(latency));
+}
+
+// Samples everything a step reads from outside into input, and logs it
+void read_inputs(){
+	uint8_t bytes[INPUT_RECORD_MAX];
+
+#ifdef INPUT_REPLAY
+	if(input_replaying){
+		// Out of log: the recorded session ended here
+		input_queue_flush();
+		if(!input_play_step(&input_player, &input)){
+			gameRunning = 0;
+			return;
 		}
+		record_bytes(bytes, input_record_step(&input_recorder, &input, bytes));
+		return;
+	}
+#endif
+
+	// Everything TIMER4 queued since the last step. A tap that is over
+	// before the step still moves it, and shots aim where the pot was
+	// when the button came up
+	uint8_t pressed = 0;
+	InputEvent event;
+	input.aim = get_aim();
+	input.fires = 0;
+
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t now = timer_ticks;
+	SREG = sreg;
+
+	while(input_queue_pop(&event)){
+		switch(event.type){
+		case INPUT_PRESS:
+			buttons_held |= 1 << event.button;
+			pressed |= 1 << event.button;
+			note_latency(now - event.tick);
+			break;
+		case INPUT_RELEASE:
+			buttons_held &= ~(1 << event.button);
+			break;
+		case INPUT_FIRE:
+			input.aim = event.angle;
+			input.fires++;
+			note_latency(now - event.tick);
+			break;
+		}
+	}
+	input.buttons = buttons_held | pressed;
+	input.serial = usb_serial_getchar();
+	input.ticks = timer_elapsed();
+
+	record_bytes(bytes, input_record_step(&input_recorder, &input, bytes));
+}
+
+// Closes a game's log, with its score and length so a replay can be checked against it
+void end_recording(){
+	uint8_t bytes[INPUT_RECORD_MAX];
+	record_bytes(bytes, input_record_flush(&input_recorder, bytes));
+	flush_record();
+
+	uint32_t result[2] = { step_count, score };
+	send_event(EVENT_GAME_OVER, result, sizeof(result));
+}
+
+char has_collided_coords( unsigned char id, int x_s, int y_s){
+	const Mask* mask = entity_mask[id];
+	int col = x_s - entity_px[id];
+	int row = y_s - entity_py[id];
+
+	if ( col < 0 || col >= mask->width || row < 0 || row >= mask->height ) return 0;
+	return ( mask->rows[row] & (0x8000 >> col) ) != 0;
+}
+
+// Pixel-exact overlap: AND the masks row by row, shifted by the column offset
+char has_collided_sprite(unsigned char id, unsigned char other ){
+	if(!is_live(id) || !is_live(other)) return 0;
+
+	const Mask* a = entity_mask[id];
+	const Mask* b = entity_mask[other];
+	int ax = entity_px[id], ay = entity_py[id];
+	int bx = entity_px[other], by = entity_py[other];
+	int shift = bx - ax;
+
+	// Also keeps the shift below 16
+	if ( shift >= a->width || -shift >= b->width ) return 0;
+
+	int top = ay > by ? ay : by;
+	int bottom = ay + a->height < by + b->height ? ay + a->height : by + b->height;
+
+	for ( int y = top; y < bottom; y++ ) {
+		uint16_t row_a = a->rows[y - ay];
+		uint16_t row_b = b->rows[y - by];
+		if ( shift >= 0 ? ( row_a & (row_b >> shift) ) : ( (row_a >> -shift) & row_b ) ) return 1;
 	}
 	return 0;
 }
 
-char has_collided_sprite(Sprite* sprite, Sprite* spr ){
-	if(sprite->is_visible && spr->is_visible){
-		int x = (int) round( sprite->x );
-		int y = (int) round( sprite->y );
-		int offset = 0;
-		for ( int row = 0; row < sprite->height; row++ ) {
-			for ( int col = 0; col < sprite->width; col++ ) {
-				char ch = sprite->bitmap[offset++] & 0xff;
-				if ( ch != ' ' ) {
-					if(has_collided_coords(spr, x + col, y + row)) return 1;
-				}
-			}
+// Broad phase: only pairs whose cached boxes overlap get the mask test
+char entities_collided(unsigned char a, unsigned char b){
+	if(!is_live(a) || !is_live(b)) return 0;
+
+	pairs_tested++;
+	if(entity_px[a] >= entity_right[b] || entity_px[b] >= entity_right[a]
+		|| entity_py[a] >= entity_bottom[b] || entity_py[b] >= entity_bottom[a]){
+		pairs_rejected++;
+		return 0;
+	}
+	return has_collided_sprite(a, b);
+}
+
+// Mark every cell holding a corner in [x0, x1) x [y0, y1)
+void spawn_block(int x0, int y0, int x1, int y1){
+	if(x1 <= 0 || y1 <= 0 || x0 >= LCD_X || y0 >= LCD_Y || x0 >= x1 || y0 >= y1) return;
+	if(x0 < 0) x0 = 0;
+	if(y0 < 0) y0 = 0;
+	if(x1 > LCD_X) x1 = LCD_X;
+	if(y1 > LCD_Y) y1 = LCD_Y;
+	unsigned char c0 = x0 / SPAWN_CELL, c1 = (x1 - 1) / SPAWN_CELL;
+	uint32_t bits = ((uint32_t)2 << c1) - ((uint32_t)1 << c0);
+	for (int row = y0 / SPAWN_CELL; row <= (y1 - 1) / SPAWN_CELL; row++){
+		spawn_cells[row] |= bits;
+	}
+}
+
+/*
+*	Place id with its corner in [1, x_max] x [10, y_max], clear of the
+*	entities in avoid and, if asked, away from the craft. Falls back to any
+*	position in range when every cell is taken.
+*/
+void place_spawn(unsigned char id, int x_max, int y_max, EntitySet avoid, char far_from_craft){
+	int w = entity_mask[id]->width, h = entity_mask[id]->height;
+	unsigned char c0 = 1 / SPAWN_CELL, c1 = x_max / SPAWN_CELL;
+	unsigned char r0 = 10 / SPAWN_CELL, r1 = y_max / SPAWN_CELL;
+	uint32_t cols = ((uint32_t)2 << c1) - ((uint32_t)1 << c0);
+
+	for (int row = 0; row < SPAWN_ROWS; row++){
+		spawn_cells[row] = 0;
+	}
+	avoid &= entity_live & ~ENTITY_BIT(id);
+	while(avoid){
+		unsigned char other = next_live(&avoid);
+		spawn_block(entity_px[other] - w + 1, entity_py[other] - h + 1, entity_right[other], entity_bottom[other]);
+	}
+	if(far_from_craft && is_live(CRAFT)){
+		int cx = entity_px[CRAFT] + (entity_right[CRAFT] - entity_px[CRAFT]) / 2 - w / 2;
+		int cy = entity_py[CRAFT] + (entity_bottom[CRAFT] - entity_py[CRAFT]) / 2 - h / 2;
+		spawn_block(cx - SPAWN_CRAFT_DISTANCE + 1, cy - SPAWN_CRAFT_DISTANCE + 1,
+			cx + SPAWN_CRAFT_DISTANCE, cy + SPAWN_CRAFT_DISTANCE);
+	}
+
+	int open_cells = 0;
+	for (int row = r0; row <= r1; row++){
+		open_cells += __builtin_popcountl(~spawn_cells[row] & cols);
+	}
+	if(open_cells == 0){
+		place_entity(id, rng_range(RNG_SPAWN, 1, x_max), rng_range(RNG_SPAWN, 10, y_max));
+		return;
+	}
+
+	int pick = rng_below(RNG_SPAWN, open_cells);
+	for (int row = r0; row <= r1; row++){
+		uint32_t open = ~spawn_cells[row] & cols;
+		int count = __builtin_popcountl(open);
+		if(pick >= count){
+			pick -= count;
+			continue;
 		}
+		while(pick--) open &= open - 1;
+		int col = __builtin_ctzl(open);
+		int x0 = col * SPAWN_CELL, x1 = x0 + SPAWN_CELL - 1;
+		int y0 = row * SPAWN_CELL, y1 = y0 + SPAWN_CELL - 1;
+		if(x0 < 1) x0 = 1;
+		if(x1 > x_max) x1 = x_max;
+		if(y0 < 10) y0 = 10;
+		if(y1 > y_max) y1 = y_max;
+		place_entity(id, rng_range(RNG_SPAWN, x0, x1), rng_range(RNG_SPAWN, y0, y1));
+		return;
 	}
-	
-	return 0;
 }
 
-char alien_collided_craft(int i){
-	if(has_collided_sprite(&craft_sprite, &alien_sprite[i])){
-		return 1;
+int grid_cell_of(int x, int y){
+	int cx = x < 0 ? 0 : (x >= LCD_X ? GRID_W - 1 : x / GRID_CELL);
+	int cy = y < 0 ? 0 : (y >= LCD_Y ? GRID_H - 1 : y / GRID_CELL);
+	return cy * GRID_W + cx;
+}
+
+void grid_clear(){
+	for (int i = 0; i < GRID_W * GRID_H; i++){
+		grid_head[i] = GRID_NONE;
+	}
+	for (int i = 0; i < ALIEN_COUNT; i++){
+		alien_cell[i] = GRID_NONE;
 	}
-	return 0;
 }
 
-char craft_collided_alien(){
-	for ( int i = 0; i < ALIEN_COUNT; i++ ){
-		if(has_collided_sprite(&craft_sprite, &alien_sprite[i])){
-			return 1;
+// Re-file an alien after it moves, appears or dies; a no-op unless its cell changed
+void grid_update(int alien){
+	unsigned char id = ALIEN(alien);
+	unsigned char cell = is_live(id) ? grid_cell_of(entity_px[id], entity_py[id]) : GRID_NONE;
+
+	if (cell == alien_cell[alien]) return;
+
+	if (alien_cell[alien] != GRID_NONE){
+		unsigned char* link = &grid_head[alien_cell[alien]];
+		while (*link != alien) link = &alien_next[*link];
+		*link = alien_next[alien];
+	}
+	if (cell != GRID_NONE){
+		alien_next[alien] = grid_head[cell];
+		grid_head[cell] = alien;
+	}
+	alien_cell[alien] = cell;
+}
+
+/*
+*	Lowest-numbered live alien colliding with entity id, looking only in
+*	the cells it can reach, or -1. As in the original all-pairs loop, a
+*	bullet takes out one alien, the lowest-numbered it touches, and the
+*	craft loses one life however many aliens it touches, since it then
+*	respawns clear of them all.
+*/
+int alien_collided(unsigned char id){
+	int left = grid_cell_of(entity_px[id], entity_py[id]);
+	int right = grid_cell_of(entity_right[id] - 1, entity_bottom[id] - 1);
+	int x0 = left % GRID_W, y0 = left / GRID_W;
+	int x1 = right % GRID_W, y1 = right / GRID_W;
+
+	int hit = -1;
+
+	if (x0 > 0) x0--;
+	if (y0 > 0) y0--;
+
+	for (int cy = y0; cy <= y1; cy++){
+		for (int cx = x0; cx <= x1; cx++){
+			for (unsigned char i = grid_head[cy * GRID_W + cx]; i != GRID_NONE; i = alien_next[i]){
+				if ((hit < 0 || i < hit) && entities_collided(id, ALIEN(i))) hit = i;
+			}
 		}
 	}
-	return 0;
+	return hit;
 }
 
 void check_collision(){
-	for(int h = 0; h < BULLET_COUNT; h++){
-		for(int i = 0; i < ALIEN_COUNT; i++){
-			if(has_collided_sprite(&bullet_sprite[h], &alien_sprite[i])) {
-				bullet_sprite[h].is_visible = 0; 
-				alien_sprite[i].is_visible = 0; 
-				send_debug_string("Player destroyed alien.");
-				score++;
-			}
+	for(EntitySet live = type_live[TYPE_BULLET]; live; ){
+		unsigned char bullet = next_live(&live);
+		int i = alien_collided(bullet);
+		if(i >= 0) {
+			despawn(bullet);
+			despawn(ALIEN(i));
+			grid_update(i);
+			send_event(EVENT_ALIEN_DESTROYED, 0, 0);
+			score++;
 		}
 	}
 
-	if(has_collided_sprite(&mothership_bullet, &craft_sprite)){
-		materialise_spaceship();
-		mothership_bullet.is_visible = 0;
-		lives--;
+	for(EntitySet live = type_live[TYPE_BOSS_BULLET]; live; ){
+		unsigned char bullet = next_live(&live);
+		if(entities_collided(bullet, CRAFT)){
+			materialise_spaceship();
+			despawn(bullet);
+			lives--;
+		}
 	}
 
-	if(has_collided_sprite(&mothership_sprite, &craft_sprite)){
-		send_debug_string("Mothership destroyed player.");
+	if(entities_collided(MOTHERSHIP, CRAFT)){
+		send_event(EVENT_MOTHERSHIP_HIT_PLAYER, 0, 0);
 		materialise_spaceship();
 		lives--;
 	}
 
-	for(int i = 0; i < BULLET_COUNT; i++){
-		if(has_collided_sprite(&bullet_sprite[i], &mothership_sprite)){
-			mothership_lives--;
-			bullet_sprite[i].is_visible = 0;
+	if(is_live(MOTHERSHIP)){
+		for(EntitySet live = type_live[TYPE_BULLET]; live; ){
+			unsigned char bullet = next_live(&live);
+			if(entities_collided(bullet, MOTHERSHIP)){
+				mothership_lives--;
+				despawn(bullet);
+			}
 		}
 	}
 
-	for(int i = 0; i < ALIEN_COUNT; i++){
-		if(has_collided_sprite(&craft_sprite, &alien_sprite[i])){
-			send_debug_string("Alien destroyed player.");
-			materialise_spaceship();
-			lives--;
-		}
+	if(alien_collided(CRAFT) >= 0){
+		send_event(EVENT_ALIEN_HIT_PLAYER, 0, 0);
+		materialise_spaceship();
+		lives--;
 	}
 
 }
 
 void mothership_attack(){
-	double angle = angle_to(mothership_sprite.x, mothership_sprite.y, craft_sprite.x, craft_sprite.y);
-	mothership_sprite.dx = cos(angle) * MOTHERSHIP_SPEED;
-	mothership_sprite.dy = sin(angle) * MOTHERSHIP_SPEED;
+	int angle = angle_to(entity_px[MOTHERSHIP], entity_py[MOTHERSHIP], entity_px[CRAFT], entity_py[CRAFT]);
+	entity_dx[MOTHERSHIP] = FIXED_MUL(cos_deg(angle), MOTHERSHIP_SPEED);
+	entity_dy[MOTHERSHIP] = FIXED_MUL(sin_deg(angle), MOTHERSHIP_SPEED);
 }
 
 void alien_attack(int alien){
-	double angle = angle_to(alien_sprite[alien].x, alien_sprite[alien].y, craft_sprite.x, craft_sprite.y);
-	alien_sprite[alien].dx = cos(angle) * ALIEN_SPEED;
-	alien_sprite[alien].dy = sin(angle) * ALIEN_SPEED;
+	unsigned char id = ALIEN(alien);
+	int angle = angle_to(entity_px[id], entity_py[id], entity_px[CRAFT], entity_py[CRAFT]);
+	entity_dx[id] = FIXED_MUL(cos_deg(angle), ALIEN_SPEED);
+	entity_dy[id] = FIXED_MUL(sin_deg(angle), ALIEN_SPEED);
+}
+
+// A 2 to 4 second pause, in timer wheel ticks
+uint16_t random_wait(){
+	return rng_range(RNG_AI, 2 * WAIT_TICKS_PER_SECOND, 4 * WAIT_TICKS_PER_SECOND);
+}
+
+// Timer callbacks, run from the main loop by timer_run()
+void alien_wait_over(uint8_t alien){
+	alien_attack(alien);
+}
+
+void mothership_wait_over(uint8_t unused){
+	(void)unused;
+	mothership_attack();
+}
+
+void mothership_fire_due(uint8_t unused){
+	(void)unused;
+	boss_shoot();
+	arm_mothership_fire();
+}
+
+// Free RAM now and the stack's headroom so far, every second
+void report_memory(uint8_t unused){
+	(void)unused;
+	uint16_t memory[2] = { ram_free(), ram_stack_headroom() };
+	send_event(EVENT_MEMORY, memory, sizeof(memory));
+	timer_start(TIMER_MEMORY, WAIT_TICKS_PER_SECOND, report_memory, 0);
+}
+
+void arm_alien(int alien){
+	timer_start(TIMER_ALIEN + alien, random_wait(), alien_wait_over, alien);
+}
+
+void arm_mothership_move(){
+	timer_start(TIMER_MOTHERSHIP_MOVE, random_wait(), mothership_wait_over, 0);
+}
+
+void arm_mothership_fire(){
+	timer_start(TIMER_MOTHERSHIP_FIRE, random_wait(), mothership_fire_due, 0);
 }
 
 void check_alien_wall(){
-	for(int i = 0; i < ALIEN_COUNT; i++){
-		if ((alien_sprite[i].x <= 2 || alien_sprite[i].x >= LCD_X - 6 || alien_sprite[i].y <= 11 || alien_sprite[i].y >= LCD_Y - 6) /*&& !on_wall[i]*/){
-			on_wall[i] = 1;
-			alien_sprite[i].dx = 0;
-			alien_sprite[i].dy = 0;
-			if(alien_wait[i] <= -5){
-				alien_wait[i] = -((double)((rand() % 200) + 200)/100.0);
-				//sprintf(buff, "Alien %d: %f", i, alien_wait[i]);
-				//send_line(buff);
-			}
+	for(EntitySet live = entity_live & ALIEN_BITS; live; ){
+		unsigned char id = next_live(&live);
+		int alien = id - ALIEN(0);
+		if ((entity_px[id] <= 2 || entity_px[id] >= LCD_X - 6 || entity_py[id] <= 11 || entity_py[id] >= LCD_Y - 6) /*&& !on_wall[i]*/){
+			entity_on_wall[id] = 1;
+			entity_dx[id] = 0;
+			entity_dy[id] = 0;
+			if(!timer_pending(TIMER_ALIEN + alien)) arm_alien(alien);
 		}
 	}
-	if ((mothership_sprite.x <= 2 || mothership_sprite.x >= LCD_X - 11 || mothership_sprite.y <= 11 || mothership_sprite.y >= LCD_Y - 9) /*&& !on_wall[i]*/){
-		m_on_wall = 1;
-		mothership_sprite.dx = 0;
-		mothership_sprite.dy = 0;
-		if(mothership_wait <= -5){
-			mothership_wait = -((double)((rand() % 200) + 200)/100.0);
-		}
+	if ((entity_px[MOTHERSHIP] <= 2 || entity_px[MOTHERSHIP] >= LCD_X - 11 || entity_py[MOTHERSHIP] <= 11 || entity_py[MOTHERSHIP] >= LCD_Y - 9) /*&& !on_wall[i]*/){
+		entity_on_wall[MOTHERSHIP] = 1;
+		entity_dx[MOTHERSHIP] = 0;
+		entity_dy[MOTHERSHIP] = 0;
+		if(!timer_pending(TIMER_MOTHERSHIP_MOVE)) arm_mothership_move();
 	}
 }
 
 void shoot(int degrees){
+	int id = acquire_projectile(TYPE_BULLET, BULLET_COUNT);
+	if(id < 0) return;
+	launch_projectile(id, aim_x, aim_y, degrees);
+}
 
-	double radians = degrees * M_PI / 180;
+fixed sin_deg(int degrees){
+	degrees %= 360;
+	if (degrees < 0) degrees += 360;
 
-	for(int i = 0; i < BULLET_COUNT; i++){
-		if (!bullet_sprite[i].is_visible){
-			bullet_sprite[i].is_visible = 1;
-			bullet_sprite[i].x = aim_x;
-			bullet_sprite[i].y = aim_y;
-			bullet_sprite[i].dx = cos(radians) * BULLET_SPEED;
-			bullet_sprite[i].dy = sin(radians) * BULLET_SPEED;
-			break;
-		}
-	}
+	if (degrees <= 90) return pgm_read_word(&sin_table[degrees]);
+	if (degrees <= 180) return pgm_read_word(&sin_table[180 - degrees]);
+	if (degrees <= 270) return -pgm_read_word(&sin_table[degrees - 180]);
+	return -pgm_read_word(&sin_table[360 - degrees]);
 }
 
-double angle_to(double x1, double y1, double x2, double y2){
-	return atan2((y2 - y1), (x2 - x1));
+fixed cos_deg(int degrees){
+	return sin_deg(degrees + 90);
+}
+
+// Whole-degree heading from (x1, y1) to (x2, y2), like atan2 but from the octant and atan_table
+int angle_to(int x1, int y1, int x2, int y2){
+	int dx = x2 - x1;
+	int dy = y2 - y1;
+	int ax = abs(dx);
+	int ay = abs(dy);
+	int angle;
+
+	if (ax == 0 && ay == 0) return 0;
+
+	if (ay <= ax) angle = pgm_read_byte(&atan_table[(ay * ATAN_STEPS + ax / 2) / ax]);
+	else angle = 90 - pgm_read_byte(&atan_table[(ax * ATAN_STEPS + ay / 2) / ay]);
+
+	if (dx < 0) angle = 180 - angle;
+	if (dy < 0) angle = -angle;
+	return angle;
 }
 
 void step_sprites(){
 
-	for (int i = 0; i < ALIEN_COUNT; i++){
-		if(alien_sprite[i].is_visible){
-			sprite_step(&alien_sprite[i]);
-			if(alien_sprite[i].x > 1 && alien_sprite[i].x < LCD_X - 6 && alien_sprite[i].y > 11 && alien_sprite[i].y < LCD_Y - 6) on_wall[i] = 0;
-		}
+	for(EntitySet live = entity_live & ALIEN_BITS; live; ){
+		unsigned char id = next_live(&live);
+		sprite_step(id);
+		grid_update(id - ALIEN(0));
+		if(entity_px[id] > 1 && entity_px[id] < LCD_X - 6 && entity_py[id] > 11 && entity_py[id] < LCD_Y - 6) entity_on_wall[id] = 0;
 	}
-	for (int i = 0; i < BULLET_COUNT; i++){
-		if(bullet_sprite[i].is_visible){
-			sprite_step(&bullet_sprite[i]);
+	for(EntitySet live = entity_live & PROJECTILE_BITS; live; ){
+		unsigned char id = next_live(&live);
+		sprite_step(id);
 
-			if(bullet_sprite[i].x > LCD_X - 1 || bullet_sprite[i].x < 1 || bullet_sprite[i].y > LCD_Y - 1 
-				|| bullet_sprite[i].y < 10) {
-				bullet_sprite[i].is_visible = 0;
-			}
+		if(entity_px[id] > LCD_X - 1 || entity_px[id] < 1 || entity_py[id] > LCD_Y - 1 
+			|| entity_py[id] < 10) {
+			despawn(id);
 		}
 	}
 
-	if(mothership_sprite.is_visible){
-		sprite_step(&mothership_sprite);
-		if(mothership_sprite.x > 1 && mothership_sprite.x < LCD_X - 6 && mothership_sprite.y > 11 && mothership_sprite.y < LCD_Y - 6) m_on_wall = 0;
-	}
-	if(mothership_bullet.is_visible){
-		sprite_step(&mothership_bullet);
-		if(mothership_bullet.x > LCD_X - 1 || mothership_bullet.x < 1 || mothership_bullet.y > LCD_Y - 1 
-				|| mothership_bullet.y < 10) {
-				mothership_bullet.is_visible = 0;
-			}
+	if(is_live(MOTHERSHIP)){
+		sprite_step(MOTHERSHIP);
+		if(entity_px[MOTHERSHIP] > 1 && entity_px[MOTHERSHIP] < LCD_X - 6 && entity_py[MOTHERSHIP] > 11 && entity_py[MOTHERSHIP] < LCD_Y - 6) entity_on_wall[MOTHERSHIP] = 0;
 	}
 }
 
+void draw_entity(unsigned char id){
+	if(!is_live(id)) return;
+	const Mask* mask = entity_mask[id];
+	blit(mask->blit, mask->width, mask->height, entity_px[id], entity_py[id]);
+	mark_drawn(entity_px[id], entity_py[id], entity_right[id] - 1, entity_bottom[id] - 1);
+}
+
 void draw_sprites(){
-	for (int i = 0; i < ALIEN_COUNT; i++){
-		if(alien_sprite[i].is_visible){
-			draw_sprite(&alien_sprite[i]);
-		}
+	for(EntitySet live = entity_live & (ALIEN_BITS | PROJECTILE_BITS); live; ){
+		draw_entity(next_live(&live));
 	}
-	for (int i = 0; i < BULLET_COUNT; i++){
-		if(bullet_sprite[i].is_visible){
-			draw_sprite(&bullet_sprite[i]);
-		}
-	}
-	if(mothership_sprite.is_visible){
-		draw_sprite(&mothership_sprite);
+	if(is_live(MOTHERSHIP)){
+		draw_entity(MOTHERSHIP);
 		draw_boss_health();
 	}
-	if(mothership_bullet.is_visible){
-		draw_sprite(&mothership_bullet);
+}
+
+void start_steps(){
+	uint8_t sreg = SREG;
+	cli();
+	step_previous_tick = TCNT1;
+	SREG = sreg;
+	step_accumulator = 0;
+}
+
+// Fixed steps owed since the last frame, from the free-running TIMER1 count
+unsigned char steps_due(){
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t now = TCNT1;
+	SREG = sreg;
+
+	// 16-bit subtraction wraps correctly across TIMER1 overflows
+	uint16_t elapsed = now - step_previous_tick;
+	step_previous_tick = now;
+	step_accumulator += (uint32_t)elapsed * 2 * STEP_HZ;
+
+	unsigned char steps = 0;
+	while (step_accumulator >= STEP_COST && steps < STEP_MAX){
+		step_accumulator -= STEP_COST;
+		steps++;
+	}
+
+	// Over budget: skip the frames we can't catch up on rather than spiral
+	if (step_accumulator >= STEP_COST) step_accumulator %= STEP_COST;
+	return steps;
+}
+
+void step_game(){
+	read_inputs();
+	if(!gameRunning) return;
+	step_count++;
+
+	timer_advance(input.ticks);
+	process_input();
+	PROFILE_LAP(PHASE_INPUT);
+	step_sprites();
+	check_alien_wall();
+	PROFILE_LAP(PHASE_MOVE);
+	check_collision();
+	publish_pairs();
+	PROFILE_LAP(PHASE_COLLISION);
+
+	if(lives < 1) { gameRunning = 0; return; }
+	if(mothership_lives < 1){
+		timer_cancel(TIMER_MOTHERSHIP_MOVE);
+		timer_cancel(TIMER_MOTHERSHIP_FIRE);
+		despawn(MOTHERSHIP);
+		mothership_lives = 10;
+		score += 10;
+		send_event(EVENT_MOTHERSHIP_DESTROYED, 0, 0);
+
+		materialise_aliens();
+		boss_time = 1;
 	}
+	if(aliens_dead() && boss_time) { boss_battle(); boss_time = 0; }
+	PROFILE_LAP(PHASE_RULES);
 }
 
 void gameLoop(){
@@ -740,47 +1430,69 @@ void gameLoop(){
 	init_variables();
 	_delay_ms(500);
 	intro_menu();
-	srand(TCNT1);
+	rng_seed(game_seed());
+	timer_init();
 	init_sprites();
 
 	materialise_spaceship();
 	materialise_aliens();
 
+	report_memory(0);
+
 	TCNT0 = 0;
 	overflow_count = 0;
 	gameRunning = 1;
 
+	// TIMER4 only queues events while the game runs, so anything queued is
+	// stale; start from the buttons as they are, and let events update them
+	input_queue_flush();
+	buttons_held = buttons_down;
+
+	// Only the first frame is sent whole; after that just what changed
+	clear_screen();
+	reset_changes();
+	mark_dirty(0, 0, LCD_X - 1, LCD_Y - 1);
+	status_drawn = 0;
+	sp_count = 0;
+	int drawn_aim = -1;	// none yet, so the first frame draws everything
+	start_steps();
+	PROFILE_MARK();
+
 	while (gameRunning){
 		process_time();
-		ADC_prep();
-		clear_screen();
-		draw_status_border();
-		process_input();
-		//sprite_step(&craft_sprite);
-		draw_sprite(&craft_sprite);
-		//sprite_step(&alien_sprite);
-		//draw_sprite(&alien_sprite);
-		step_sprites();
-		draw_sprites();
-		check_alien_wall();
-		check_collision();
-		draw_aim_line(ceil(ADC * 0.705));
-		//previous_time = get_system_time();
-		show_screen();
+		PROFILE_LAP(PHASE_TIME);
+
+		// Simulate at STEP_HZ whatever the frame rate, then draw the result once
+		unsigned char steps = steps_due();
+		for (unsigned char i = 0; i < steps && gameRunning; i++){
+			step_game();
+		}
+		if(!gameRunning) break;
 
-		if(lives < 1) { gameRunning = 0; break; };
-		if(mothership_lives < 1){
-			mothership_fire = -5;
-			mothership_sprite.is_visible = 0;
-			mothership_lives = 10;
-			score += 10;
-			send_debug_string("Player destroyed mothership.");
+		// With no step run and the aim held still, only the status row can change
+		int aim = get_aim();
+		char redraw = steps || aim != drawn_aim;
 
-			materialise_aliens();
-			boss_time = 1;
+		if(redraw) erase_drawn(1, 10, LCD_X - 2, LCD_Y - 2);
+		PROFILE_LAP(PHASE_ERASE);
+		draw_status_border();
+		PROFILE_LAP(PHASE_STATUS);
+		if(redraw){
+			draw_entity(CRAFT);
+			draw_sprites();
+		}
+		PROFILE_LAP(PHASE_SPRITES);
+		if(redraw){
+			draw_aim_line(aim);
+			drawn_aim = aim;
 		}
-		if(aliens_dead() && boss_time) { boss_battle(); boss_time = 0; }
+		PROFILE_LAP(PHASE_AIM);
+		show_changes();
+		PROFILE_LAP(PHASE_SHOW);
+		PROFILE_FRAME(send_event);
 	}
+	end_recording();
+	report_latency();
 	clear_screen();
 	show_screen();
 }
@@ -788,11 +1500,11 @@ void gameLoop(){
 void playagain(){
 
 	clear_screen();
-	draw_string((LCD_X - (9*5))/2, 0, "GAME OVER");
-	draw_string(1, 16, "You have lost");
-	draw_string(1, 24, "Alien Advance");
-	draw_string(1, 32, "Press a button");
-	draw_string(1, 40, "to restart...");
+	draw_string_P((LCD_X - (9*5))/2, 0, PSTR("GAME OVER"));
+	draw_string_P(1, 16, PSTR("You have lost"));
+	draw_string_P(1, 24, PSTR("Alien Advance"));
+	draw_string_P(1, 32, PSTR("Press a button"));
+	draw_string_P(1, 40, PSTR("to restart..."));
 	show_screen();
 	wait_for_press();
 
@@ -805,15 +1517,15 @@ int main(){
 	set_clock_speed(CPU_8MHz);
 	init_hardware();
 
-	draw_centred(17, "Waiting for");
-	draw_centred(24, "USB Connection...");
+	draw_centred_P(17, PSTR("Waiting for"));
+	draw_centred_P(24, PSTR("USB Connection..."));
 
 	show_screen();
 	while(!usb_configured() || !usb_serial_get_control());
-	send_debug_string("Greetings from the teensy. Debugger initialised.");
+	send_event(EVENT_HELLO, 0, 0);
 	clear_screen();
-	draw_centred(17, "Connected to");
-	draw_centred(24, "USB!");
+	draw_centred_P(17, PSTR("Connected to"));
+	draw_centred_P(24, PSTR("USB!"));
 	show_screen();
 	_delay_ms(500);
 
@@ -829,86 +1541,75 @@ int main(){
 */
 
 ISR(TIMER4_OVF_vect){
-	difference = get_global_time() - previous_time;
-	previous_time = get_global_time();
-
-	for (int i = 0; i < NUM_BUTTONS; i++){
-		btn_hists[i] = btn_hists[i]<<1;
-	}
-
-	if (PIND >> PD1 & 1) btn_hists[BTN_DPAD_UP] |= 1;
-	if (PIND >> PD0 & 1) btn_hists[BTN_DPAD_RIGHT] |= 1; 
-	if (PINB >> PB1 & 1) btn_hists[BTN_DPAD_LEFT] |= 1;
-	if (PINB >> PB7 & 1) btn_hists[BTN_DPAD_DOWN] |= 1;
-	if (PINF >> PF5 & 1) btn_hists[BTN_RIGHT] |= 1;
-	if (PINF >> PF6 & 1) btn_hists[BTN_LEFT] |= 1;
-
-	for (int i = 0; i < NUM_BUTTONS; i++){
-		if(btn_hists[i] == 0xFF && btn_held[i] == BTN_STATE_UP){
-			btn_held[i] = BTN_STATE_DOWN;
-		}
-		else if (btn_hists[i] == 0 && btn_held[i] == BTN_STATE_DOWN){
-			btn_held[i] = BTN_STATE_UP;
-			if(i == BTN_LEFT || i == BTN_RIGHT){
-				shoot(ceil(ADC * 0.705));
+	// After the tick, so the profiler's clock has caught up with this overflow
+	timer_tick();
+	PROFILE_ISR_ENTER();
+
+	uint8_t sample = 0;
+	if (PINB >> PB1 & 1) sample |= 1 << BTN_DPAD_LEFT;
+	if (PIND >> PD0 & 1) sample |= 1 << BTN_DPAD_RIGHT;
+	if (PIND >> PD1 & 1) sample |= 1 << BTN_DPAD_UP;
+	if (PINB >> PB7 & 1) sample |= 1 << BTN_DPAD_DOWN;
+	if (PINF >> PF6 & 1) sample |= 1 << BTN_LEFT;
+	if (PINF >> PF5 & 1) sample |= 1 << BTN_RIGHT;
+
+	uint8_t flipped = debounce(&debouncer, sample);
+	buttons_down = debouncer.state;
+
+	// Nearly every tick ends here
+	if(flipped && gameRunning){
+		uint8_t pressed = DEBOUNCE_PRESSED(&debouncer, flipped);
+		uint16_t tick = timer_ticks;
+		for (uint8_t i = 0; i < NUM_BUTTONS; i++){
+			if(!(flipped & 1 << i)) continue;
+			if(pressed & 1 << i){
+				input_queue_push(INPUT_PRESS, i, 0, tick);
+			}
+			else {
+				input_queue_push(INPUT_RELEASE, i, 0, tick);
+				// ADC_vect can't run in here, so aim_degrees is whole
+				if(i == BTN_LEFT || i == BTN_RIGHT) input_queue_push(INPUT_FIRE, i, aim_degrees, tick);
 			}
 		}
 	}
+	PROFILE_ISR_EXIT(ISR_TIMER4);
+}
 
-	for(int i = 0; i < ALIEN_COUNT; i++){
-		
-
-		if(alien_wait[i] >= 0){
-			alien_wait[i] = -5;
-			alien_attack(i);
-		}
-		else if (alien_wait[i] < -4){
-
-		}
-		else{
-			alien_wait[i] += difference;
-		}
-		
-	}
-
-	if(mothership_wait >= 0){
-		mothership_wait = -5;
-		mothership_attack();
-	}
-	else if(mothership_wait < -4){
 
+ISR(ADC_vect) {
+	PROFILE_ISR_ENTER();
+	adc_latest = ADC;
+	adc_sum += adc_latest;
+	if(++adc_samples < ADC_OVERSAMPLE){
+		PROFILE_ISR_EXIT(ISR_ADC);
+		return;
 	}
-	else {
-		mothership_wait += difference;
-	}
-
-	if(mothership_sprite.is_visible){
-		if(mothership_fire >= 0){
-		boss_shoot();
-		mothership_fire = -((double)((rand() % 200) + 200)/100.0);
-		}
-		else if(mothership_fire < -4){
 
-		}
-		else {
-			mothership_fire += difference;
-		}
-	}
+	// Aim = mean * 0.705, as the pot was read before
+	adc_filter += (adc_sum >> ADC_FILTER_SHIFT) - (adc_filter >> ADC_FILTER_SHIFT);
+	aim_degrees = ((uint32_t)adc_filter * 705) / (ADC_OVERSAMPLE * 1000UL);
+	adc_sum = 0;
+	adc_samples = 0;
+	PROFILE_ISR_EXIT(ISR_ADC);
 }
 
-
 ISR(TIMER3_COMPA_vect) {
+	PROFILE_ISR_ENTER();
 	if(usb_configured() && usb_serial_get_control() && gameRunning){
 		send_status();
 	}
+	PROFILE_ISR_EXIT(ISR_TIMER3);
 }
 
 ISR(TIMER1_OVF_vect) {
+	PROFILE_ISR_ENTER();
 	debug_overflow_count++;
-	
+	PROFILE_ISR_EXIT(ISR_TIMER1);
 }
 
 ISR(TIMER0_OVF_vect) {
+	PROFILE_ISR_ENTER();
 	overflow_count++;
+	PROFILE_ISR_EXIT(ISR_TIMER0);
 }
 
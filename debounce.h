@@ -0,0 +1,63 @@
+#ifndef debounce_h__
+#define debounce_h__
+
+/*
+*	Debounces up to eight buttons at once with vertical counters.
+*
+*	Each sample is a byte with one bit per button, set while it is down.
+*	Bit i of count0..count2 together hold button i's count of consecutive
+*	samples that disagree with its debounced state: a sample that agrees
+*	clears it, and when it reaches DEBOUNCE_DEPTH the state flips. All
+*	eight counters step together in a dozen or so logic operations,
+*	whatever the depth, and the flips come back as one mask.
+*/
+
+#include <stdint.h>
+
+#ifndef DEBOUNCE_DEPTH
+#define DEBOUNCE_DEPTH 4	// samples, 1 to 7
+#endif
+
+#if DEBOUNCE_DEPTH < 1 || DEBOUNCE_DEPTH > 7
+#error "DEBOUNCE_DEPTH must be 1 to 7"
+#endif
+
+#define DEBOUNCE_TICK_MS 4.096	// TIMER4 overflow, where samples are taken
+
+typedef struct {
+	uint8_t state;	// debounced, bit set while down
+	uint8_t count0, count1, count2;
+} Debouncer;
+
+// Slice n of the counters, inverted where DEBOUNCE_DEPTH has a 0 bit, so
+// ANDing all three leaves the counters that equal DEBOUNCE_DEPTH
+#define DEBOUNCE_MATCH(count, n) ((DEBOUNCE_DEPTH >> (n) & 1) ? (count) : (uint8_t)~(count))
+
+// take one sample; returns the buttons whose debounced state just flipped
+static inline uint8_t debounce(Debouncer *d, uint8_t sample){
+	uint8_t differ = d->state ^ sample;
+	uint8_t c0 = d->count0 & differ;
+	uint8_t c1 = d->count1 & differ;
+	uint8_t c2 = d->count2 & differ;
+
+	// Add one to each differing counter, rippling the carry up the slices
+	uint8_t carry = differ;
+	c0 ^= carry;
+	carry &= ~c0;
+	c1 ^= carry;
+	carry &= ~c1;
+	c2 ^= carry;
+
+	uint8_t flipped = differ & DEBOUNCE_MATCH(c0, 0) & DEBOUNCE_MATCH(c1, 1) & DEBOUNCE_MATCH(c2, 2);
+	d->state ^= flipped;
+	d->count0 = c0 & ~flipped;
+	d->count1 = c1 & ~flipped;
+	d->count2 = c2 & ~flipped;
+	return flipped;
+}
+
+// Of the buttons that just flipped, those now down and those now up
+#define DEBOUNCE_PRESSED(d, flipped) ((uint8_t)((flipped) & (d)->state))
+#define DEBOUNCE_RELEASED(d, flipped) ((uint8_t)((flipped) & ~(d)->state))
+
+#endif
@@ -0,0 +1,148 @@
+/*
+*	Headless frame-throughput benchmark.
+*	Runs assignment.c's gameLoop() against the host stand-ins for a fixed
+*	number of frames and reports frames/sec and per-frame time percentiles.
+*
+*	With -r the games are played from an input log instead of the scripted
+*	buttons, until the log runs out (see input_log.h and decode -i). With -s
+*	the first game is seeded from the argument, and each later one from the
+*	next value, instead of from TIMER1.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "sim.h"
+#include "input_log.h"
+
+extern unsigned long lcd_bytes_written;
+
+// From assignment.c
+extern char gameRunning;
+extern InputPlayer input_player;
+extern char input_replaying;
+extern char seed_given;
+extern uint16_t seed_next;
+void init_hardware();
+void gameLoop();
+void playagain();
+
+static unsigned long target_frames = 20000;
+static unsigned long frames = 0;
+static double* frame_ns;
+static struct timespec frame_start;
+static char timing = 0;
+
+static double elapsed_ns(struct timespec* a, struct timespec* b){
+	return (b->tv_sec - a->tv_sec) * 1e9 + (b->tv_nsec - a->tv_nsec);
+}
+
+// Each gameplay show_screen() closes the frame that started after the last one.
+static void on_frame(){
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	if (!gameRunning){
+		timing = 0;
+		return;
+	}
+	if (timing && frames < target_frames){
+		frame_ns[frames++] = elapsed_ns(&frame_start, &now);
+		if (frames == target_frames) gameRunning = 0;
+	}
+	timing = 1;
+	frame_start = now;
+}
+
+static int compare_double(const void* a, const void* b){
+	double x = *(const double*)a, y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+static double percentile(double* sorted, unsigned long n, double p){
+	unsigned long rank = (unsigned long)(p / 100.0 * n + 0.5);
+	if (rank < 1) rank = 1;
+	if (rank > n) rank = n;
+	return sorted[rank - 1];
+}
+
+static void load_replay(const char* path){
+	FILE* f = fopen(path, "rb");
+	if (!f){
+		perror(path);
+		exit(1);
+	}
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	rewind(f);
+
+	uint8_t* data = malloc(size ? size : 1);
+	if (fread(data, 1, size, f) != (size_t)size){
+		perror(path);
+		exit(1);
+	}
+	fclose(f);
+
+	input_play_open(&input_player, data, size);
+	input_replaying = 1;
+}
+
+static void usage(const char* name){
+	fprintf(stderr, "usage: %s [-n frames] [-u virtual_us_per_frame] [-v] [-r input_log] [-s seed]\n", name);
+	exit(2);
+}
+
+int main(int argc, char** argv){
+	for (int i = 1; i < argc; i++){
+		if (!strcmp(argv[i], "-n") && i + 1 < argc) target_frames = strtoul(argv[++i], 0, 10);
+		else if (!strcmp(argv[i], "-u") && i + 1 < argc) sim_frame_cycles = strtoul(argv[++i], 0, 10) * (SIM_F_CPU / 1000000);
+		else if (!strcmp(argv[i], "-v")) sim_echo_serial = 1;
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc) load_replay(argv[++i]);
+		else if (!strcmp(argv[i], "-s") && i + 1 < argc){
+			seed_next = strtoul(argv[++i], 0, 0);
+			seed_given = 1;
+		}
+		else usage(argv[0]);
+	}
+	if (!target_frames) usage(argv[0]);
+
+	frame_ns = malloc(target_frames * sizeof(double));
+	sim_frame_hook = on_frame;
+
+	struct timespec start, end;
+	unsigned long games = 0;
+
+	init_hardware();
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (frames < target_frames && !(input_replaying && input_play_done(&input_player))){
+		gameLoop();
+		games++;
+		if (frames < target_frames) playagain();
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double total_ns = 0;
+	for (unsigned long i = 0; i < frames; i++) total_ns += frame_ns[i];
+	qsort(frame_ns, frames, sizeof(double), compare_double);
+
+	// With -v stdout carries the serial stream, so report on stderr
+	fflush(stdout);
+	FILE *report = sim_echo_serial ? stderr : stdout;
+
+	fprintf(report, "frames        %lu (%lu games, %.1f virtual s)\n", frames, games, (double)sim_cycles / SIM_F_CPU);
+	fprintf(report, "frames/sec    %.0f\n", frames / (total_ns / 1e9));
+	fprintf(report, "wall time     %.3f s\n", elapsed_ns(&start, &end) / 1e9);
+	fprintf(report, "frame us      min %.2f  p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n",
+		frame_ns[0] / 1e3,
+		percentile(frame_ns, frames, 50) / 1e3,
+		percentile(frame_ns, frames, 90) / 1e3,
+		percentile(frame_ns, frames, 99) / 1e3,
+		frame_ns[frames - 1] / 1e3);
+	fprintf(report, "serial bytes  %lu\n", sim_serial_bytes);
+	fprintf(report, "lcd bytes     %lu\n", lcd_bytes_written);
+
+	free(frame_ns);
+	return 0;
+}
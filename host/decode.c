@@ -0,0 +1,262 @@
+/*
+*	Turns the Teensy's binary event stream (see telemetry.h) back into
+*	the readable debug lines it used to send.
+*
+*	stty -F /dev/ttyACM0 raw && ./decode /dev/ttyACM0
+*	./bench -v | ./decode
+*
+*	-i FILE saves the input log carried by EVENT_INPUT frames, for
+*	./bench -r FILE to replay. The log begins at the next game to start,
+*	so a capture can attach at any point, and a game cut short by the
+*	Teensy resetting is left out. If a frame after that is missing from
+*	the sequence the log can't be replayed, so FILE is removed and decode
+*	exits 1.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "telemetry.h"
+#include "profile.h"
+#include "debounce.h"
+
+#define FRAME_MAX 256
+
+static unsigned long frames, bad_frames, stream_bytes;
+static FILE *input_log;
+static uint8_t input_started;		// a game's first EVENT_INPUT has been seen
+static uint8_t input_sequence;		// expected next EVENT_INPUT number
+static unsigned long input_lost;
+
+// The game in progress, held back until it is known to be whole
+static uint8_t *game_log;
+static size_t game_size, game_room;
+
+// Undo the byte stuffing; returns the decoded length, or -1 if malformed
+static int cobs_decode(const uint8_t *in, int size, uint8_t *out){
+	int i = 0, n = 0;
+
+	while (i < size){
+		uint8_t code = in[i++];
+		if (code == 0) return -1;
+		for (int k = 1; k < code; k++){
+			if (i >= size) return -1;
+			out[n++] = in[i++];
+		}
+		if (code < 0xFF && i < size) out[n++] = 0;
+	}
+	return n;
+}
+
+static uint16_t u16_at(const uint8_t *p){
+	return p[0] | p[1] << 8;
+}
+
+static uint32_t u32_at(const uint8_t *p){
+	return u16_at(p) | (uint32_t)u16_at(p + 2) << 16;
+}
+
+// Payload bytes each event needs
+static const int payload_size[EVENT_COUNT] = {
+	[EVENT_STATUS] = 8,
+	[EVENT_COLLISION_PAIRS] = 8,
+	[EVENT_SERIAL_DROPS] = 4,
+	[EVENT_INPUT] = 2,
+	[EVENT_GAME_OVER] = 8,
+	[EVENT_PROFILE] = 7 + PROFILE_BUCKETS,
+	[EVENT_MEMORY] = 4,
+	[EVENT_ISR] = 7,
+	[EVENT_LATENCY] = 8,
+};
+
+static const char *phase_names[PHASE_COUNT] = {
+	[PHASE_TIME] = "time",
+	[PHASE_INPUT] = "input",
+	[PHASE_MOVE] = "move",
+	[PHASE_COLLISION] = "collision",
+	[PHASE_RULES] = "rules",
+	[PHASE_ERASE] = "erase",
+	[PHASE_STATUS] = "status",
+	[PHASE_SPRITES] = "sprites",
+	[PHASE_AIM] = "aim",
+	[PHASE_SHOW] = "show",
+};
+
+static const char *isr_names[ISR_COUNT] = {
+	[ISR_TIMER4] = "timer4",
+	[ISR_ADC] = "adc",
+	[ISR_TIMER3] = "timer3",
+	[ISR_TIMER1] = "timer1",
+	[ISR_TIMER0] = "timer0",
+	[ISR_USB_GEN] = "usb_gen",
+	[ISR_USB_COM] = "usb_com",
+};
+
+static void save_game(void){
+	if (input_log) fwrite(game_log, 1, game_size, input_log);
+	game_size = 0;
+}
+
+static void keep_input(const uint8_t *p, int size){
+	if (game_size + size > game_room){
+		game_room = game_room ? game_room * 2 : 4096;
+		if (!(game_log = realloc(game_log, game_room))){
+			perror("input log");
+			exit(1);
+		}
+	}
+	memcpy(game_log + game_size, p, size);
+	game_size += size;
+}
+
+// p[0] is the frame number, the rest input log bytes
+static void input_frame(const uint8_t *p, int size){
+	uint8_t sequence = p[0] & INPUT_SEQUENCE_MASK;
+	uint8_t skipped = (sequence - input_sequence) & INPUT_SEQUENCE_MASK;
+
+	if (!input_started && !(p[0] & INPUT_GAME_START)) return;
+
+	// Numbered from 0 again: the Teensy reset, cutting short the game in hand
+	if (p[0] == INPUT_GAME_START && skipped) game_size = 0;
+	else if (input_started) input_lost += skipped;
+
+	if (p[0] & INPUT_GAME_START) save_game();
+	input_started = 1;
+	input_sequence = (sequence + 1) & INPUT_SEQUENCE_MASK;
+	keep_input(p + 1, size - 1);
+}
+
+static void print_event(const uint8_t *frame, int size){
+	if (size < 5 || frame[4] >= EVENT_COUNT || size - 5 < payload_size[frame[4]]){
+		bad_frames++;
+		return;
+	}
+	frames++;
+
+	const uint8_t *p = frame + 5;
+	if (frame[4] == EVENT_INPUT){
+		input_frame(p, size - 5);
+		return;
+	}
+
+	printf("[DEBUG @ %03.03f] ", u32_at(frame) / TELEMETRY_TICKS_PER_SECOND);
+
+	switch (frame[4]){
+	case EVENT_HELLO:
+		printf("Greetings from the teensy. Debugger initialised.\n");
+		break;
+	case EVENT_ALIEN_DESTROYED:
+		printf("Player destroyed alien.\n");
+		break;
+	case EVENT_MOTHERSHIP_HIT_PLAYER:
+		printf("Mothership destroyed player.\n");
+		break;
+	case EVENT_ALIEN_HIT_PLAYER:
+		printf("Alien destroyed player.\n");
+		break;
+	case EVENT_MOTHERSHIP_DESTROYED:
+		printf("Player destroyed mothership.\n");
+		break;
+	case EVENT_STATUS:
+		printf("Location: ( %d, %d) Aim: %d FPS: %d\n", (int16_t)u16_at(p),
+			(int16_t)u16_at(p + 2), (int16_t)u16_at(p + 4), (int16_t)u16_at(p + 6));
+		break;
+	case EVENT_COLLISION_PAIRS:
+		printf("Collision pairs: %u tested, %u rejected\n", u32_at(p), u32_at(p + 4));
+		break;
+	case EVENT_SERIAL_DROPS:
+		printf("Serial queue dropped %u messages, %u bytes\n", u16_at(p), u16_at(p + 2));
+		break;
+	case EVENT_PROFILE:
+		if (p[0] >= PHASE_COUNT){
+			printf("Profile phase %u?\n", p[0]);
+			break;
+		}
+		printf("Profile %-9s min %5u avg %5u max %5u us, %%", phase_names[p[0]],
+			u16_at(p + 1) * PROFILE_US_PER_COUNT, u16_at(p + 3) * PROFILE_US_PER_COUNT,
+			u16_at(p + 5) * PROFILE_US_PER_COUNT);
+		for (int b = 0; b < PROFILE_BUCKETS; b++) printf(" %3u", p[7 + b]);
+		printf(" (<16us .. >=1ms)\n");
+		break;
+	case EVENT_GAME_OVER:
+		save_game();
+		printf("Game over after %u steps, score %u\n", u32_at(p), u32_at(p + 4));
+		break;
+	case EVENT_MEMORY:
+		printf("Free RAM: %u bytes, stack headroom %u bytes\n", u16_at(p), u16_at(p + 2));
+		break;
+	case EVENT_LATENCY:
+		printf("Input latency: %u presses, min %.1f avg %.1f max %.1f ms\n", u16_at(p),
+			u16_at(p + 2) * DEBOUNCE_TICK_MS, u16_at(p + 4) * DEBOUNCE_TICK_MS,
+			u16_at(p + 6) * DEBOUNCE_TICK_MS);
+		break;
+	case EVENT_ISR:
+		if (p[0] >= ISR_COUNT){
+			printf("ISR %u?\n", p[0]);
+			break;
+		}
+		printf("ISR %-8s %6u entries, longest %5u us\n", isr_names[p[0]],
+			u32_at(p + 1), u16_at(p + 5) * PROFILE_US_PER_COUNT);
+		break;
+	}
+	fflush(stdout);
+}
+
+static void usage(const char *name){
+	fprintf(stderr, "usage: %s [-i input_log] [stream]\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv){
+	FILE *in = stdin;
+	const char *input_path = 0;
+	int i = 1;
+
+	if (i + 1 < argc && !strcmp(argv[i], "-i")){
+		input_path = argv[i + 1];
+		if (!(input_log = fopen(input_path, "wb"))){
+			perror(input_path);
+			return 1;
+		}
+		i += 2;
+	}
+	if (i + 1 < argc || (i < argc && argv[i][0] == '-')) usage(argv[0]);
+	if (i < argc && !(in = fopen(argv[i], "rb"))){
+		perror(argv[i]);
+		return 1;
+	}
+
+	uint8_t encoded[FRAME_MAX], frame[FRAME_MAX];
+	int length = 0, overrun = 0;
+	int c;
+
+	while ((c = getc(in)) != EOF){
+		stream_bytes++;
+		if (c != 0){
+			// Too long to be ours: skip to the next delimiter
+			if (length == FRAME_MAX) overrun = 1;
+			else encoded[length++] = c;
+			continue;
+		}
+
+		int size = overrun ? -1 : cobs_decode(encoded, length, frame);
+		if (size < 0) bad_frames++;
+		else if (length > 0) print_event(frame, size);
+		length = 0;
+		overrun = 0;
+	}
+
+	fprintf(stderr, "%lu events in %lu bytes, %lu bad frames\n", frames, stream_bytes, bad_frames);
+	if (input_log){
+		save_game();
+		fclose(input_log);
+		if (input_lost){
+			fprintf(stderr, "%lu input log frames lost, %s removed\n", input_lost, input_path);
+			remove(input_path);
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,64 @@
+#include <stdlib.h>
+
+#include "graphics.h"
+#include "sim.h"
+
+unsigned char screen_buffer[LCD_BUFFER_SIZE];
+
+void clear_screen(void){
+	for (int i = 0; i < LCD_BUFFER_SIZE; i++){
+		screen_buffer[i] = 0;
+	}
+}
+
+void show_screen(void){
+	sim_show_screen();
+	lcd_position(0, 0);
+	for (int i = 0; i < LCD_BUFFER_SIZE; i++){
+		lcd_write(LCD_D, screen_buffer[i]);
+	}
+}
+
+void set_pixel(unsigned char x, unsigned char y, unsigned char value){
+	if (x >= LCD_X || y >= LCD_Y) return;
+	unsigned char bank = y >> 3;
+	unsigned char pixel = y & 7;
+	if (value){
+		screen_buffer[bank * LCD_X + x] |= (1 << pixel);
+	}
+	else {
+		screen_buffer[bank * LCD_X + x] &= ~(1 << pixel);
+	}
+}
+
+void draw_line(int x1, int y1, int x2, int y2){
+	int dx = abs(x2 - x1), sx = x1 < x2 ? 1 : -1;
+	int dy = -abs(y2 - y1), sy = y1 < y2 ? 1 : -1;
+	int err = dx + dy;
+	while (1){
+		set_pixel(x1, y1, 1);
+		if (x1 == x2 && y1 == y2) break;
+		int e2 = 2 * err;
+		if (e2 >= dy){ err += dy; x1 += sx; }
+		if (e2 <= dx){ err += dx; y1 += sy; }
+	}
+}
+
+// Stand-in glyphs: the real font table isn't needed to profile, only the
+// library's per-pixel cost of 5 columns by 8 rows per character.
+void draw_char(unsigned char top_left_x, unsigned char top_left_y, char character){
+	for (unsigned char col = 0; col < 5; col++){
+		unsigned char bits = (unsigned char)(character * (col + 3)) & 0x7F;
+		for (unsigned char row = 0; row < 8; row++){
+			set_pixel(top_left_x + col, top_left_y + row, (bits >> row) & 1);
+		}
+	}
+}
+
+void draw_string(unsigned char top_left_x, unsigned char top_left_y, char *text){
+	unsigned char x = top_left_x;
+	while (*text){
+		draw_char(x, top_left_y, *text++);
+		x += 5;
+	}
+}
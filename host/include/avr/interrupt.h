@@ -0,0 +1,12 @@
+#ifndef HOST_AVR_INTERRUPT_H
+#define HOST_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+// Vectors become ordinary functions that host/sim.c calls as timers expire.
+#define ISR(vector) void vector(void)
+
+void sei(void);
+void cli(void);
+
+#endif
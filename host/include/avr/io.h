@@ -0,0 +1,88 @@
+#ifndef HOST_AVR_IO_H
+#define HOST_AVR_IO_H
+
+/*
+*	Host stand-in for <avr/io.h>.
+*	Only the ATmega32U4 registers and bit names used by the game exist here.
+*	Registers are plain globals owned by host/sim.c, which advances the
+*	timers and fires the ISRs as virtual time passes.
+*/
+
+#include <stdint.h>
+
+extern volatile uint8_t DDRB, DDRD, DDRF;
+extern volatile uint8_t PORTB, PORTD, PORTF;
+extern volatile uint8_t PINB, PIND, PINF;
+
+extern volatile uint8_t TCCR0A, TCCR0B, TIMSK0, TCNT0;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+extern volatile uint16_t TCNT1;
+extern volatile uint8_t TCCR3A, TCCR3B, TIMSK3;
+extern volatile uint16_t TCNT3, OCR3A;
+extern volatile uint8_t TCCR4A, TCCR4B, TIMSK4, TIFR4, TCNT4;
+
+extern volatile uint8_t ADMUX, ADCSRA, ADCSRB;
+extern volatile uint16_t ADC;
+
+extern volatile uint8_t SREG;
+
+#define PB1 1
+#define PB2 2
+#define PB3 3
+#define PB7 7
+#define PD0 0
+#define PD1 1
+#define PF5 5
+#define PF6 6
+
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM02 3
+#define TOIE0 0
+
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define TOIE1 0
+#define TOV1 0
+
+#define CS30 0
+#define CS31 1
+#define CS32 2
+#define WGM32 3
+#define COM3A1 7
+#define OCIE3A 1
+
+#define CS40 0
+#define CS41 1
+#define CS42 2
+#define CS43 3
+#define TOIE4 2
+#define TOV4 2
+
+#define MUX0 0
+#define MUX1 1
+#define MUX2 2
+#define MUX3 3
+#define MUX4 4
+#define REFS0 6
+#define REFS1 7
+
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+
+#define ADTS0 0
+#define ADTS1 1
+#define ADTS2 2
+#define ADTS3 3
+#define MUX5 5
+
+#endif
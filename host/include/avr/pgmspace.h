@@ -0,0 +1,15 @@
+#ifndef HOST_AVR_PGMSPACE_H
+#define HOST_AVR_PGMSPACE_H
+
+// The host has a single address space, so flash accessors are plain loads.
+
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(addr) (*(const unsigned char*)(addr))
+#define pgm_read_word(addr) (*(const unsigned short*)(addr))
+#define strlen_P strlen
+#define sprintf_P sprintf
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_GRAPHICS_H
+#define HOST_GRAPHICS_H
+
+// Host stand-in for the CAB202 graphics library.
+
+#include "lcd.h"
+
+#define LCD_BUFFER_SIZE (LCD_X * (LCD_Y / 8))
+
+extern unsigned char screen_buffer[LCD_BUFFER_SIZE];
+
+void clear_screen(void);
+void show_screen(void);
+void set_pixel(unsigned char x, unsigned char y, unsigned char value);
+void draw_line(int x1, int y1, int x2, int y2);
+void draw_char(unsigned char top_left_x, unsigned char top_left_y, char character);
+void draw_string(unsigned char top_left_x, unsigned char top_left_y, char *text);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_LCD_H
+#define HOST_LCD_H
+
+// Host stand-in for the CAB202 PCD8544 LCD driver.
+
+#define LCD_X 84
+#define LCD_Y 48
+
+#define LCD_DEFAULT_CONTRAST 0x3F
+
+#define LCD_C 0
+#define LCD_D 1
+
+void lcd_init(unsigned char contrast);
+void lcd_write(unsigned char dc, unsigned char data);
+void lcd_position(unsigned char x, unsigned char y);
+void lcd_clear(void);
+
+#endif
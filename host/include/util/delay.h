@@ -0,0 +1,9 @@
+#ifndef HOST_UTIL_DELAY_H
+#define HOST_UTIL_DELAY_H
+
+// Delays advance virtual time without sleeping so sessions run at full speed.
+
+void _delay_ms(double ms);
+void _delay_us(double us);
+
+#endif
@@ -0,0 +1,43 @@
+#include "lcd.h"
+
+/*
+*	The PCD8544 is write-only; the host keeps its display RAM so pushes can
+*	be checked against the frame buffer, and counts what crosses the SPI bus.
+*/
+
+unsigned long lcd_bytes_written = 0;
+unsigned char lcd_ram[LCD_X * LCD_Y / 8];
+
+static unsigned char lcd_x = 0, lcd_bank = 0;
+
+void lcd_init(unsigned char contrast){
+	(void)contrast;
+	lcd_clear();
+}
+
+void lcd_write(unsigned char dc, unsigned char data){
+	lcd_bytes_written++;
+	if (dc == LCD_C){
+		if (data & 0x80) lcd_x = (data & 0x7F) % LCD_X;
+		else if (data & 0x40) lcd_bank = (data & 0x07) % (LCD_Y / 8);
+		return;
+	}
+	// Horizontal addressing: X wraps into the next bank
+	lcd_ram[lcd_bank * LCD_X + lcd_x] = data;
+	if (++lcd_x == LCD_X){
+		lcd_x = 0;
+		lcd_bank = (lcd_bank + 1) % (LCD_Y / 8);
+	}
+}
+
+void lcd_position(unsigned char x, unsigned char y){
+	lcd_write(LCD_C, 0x80 | x);
+	lcd_write(LCD_C, 0x40 | y);
+}
+
+void lcd_clear(void){
+	lcd_position(0, 0);
+	for (int i = 0; i < LCD_X * LCD_Y / 8; i++){
+		lcd_write(LCD_D, 0);
+	}
+}
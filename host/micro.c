@@ -0,0 +1,311 @@
+/*
+*	Microbenchmarks for the game's hot kernels, run against the host
+*	stand-ins:
+*
+*	  has_collided_sprite   one pair test, all pairs of the live entities
+*	  has_collided_coords   one point test against one entity
+*	  sprite_step           one entity step
+*	  draw_aim_line         one aim line, the angle sweeping round
+*	  clear_game_screen     one clear of the play area
+*	  blit                  one draw_entity(): blit() plus mark_drawn()
+*
+*	Entities are placed at random in a square sized so their bounding
+*	boxes cover `density` of it, so density sets how many pairs overlap.
+*	Each case reports the best of several timed runs in ns/op, and heap
+*	allocations per op (malloc/calloc/realloc, counted by --wrap).
+*
+*	  ./micro [-e entities] [-d density] [-o results.json]
+*	  ./micro -b baseline.json [-t percent]
+*
+*	With -b every case is compared with the same case in the baseline,
+*	and the exit status is 1 if any is more than -t percent (default 10)
+*	slower, so a rewritten kernel has to at least hold the baseline.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+// The game itself, so the kernels and the pool's macros are in reach
+#define main alien_main
+#include "../assignment.c"
+#undef main
+
+#define RUNS 9
+#define RUN_NS 20e6
+#define POINTS 256
+#define CASES_MAX 64
+
+typedef struct {
+	char name[32];
+	int entities;
+	double density;
+	double ns_per_op;
+	double allocs_per_op;
+} Result;
+
+static Result results[CASES_MAX];
+static int result_count;
+
+static unsigned long allocations;
+static volatile unsigned long sink;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *p, size_t size);
+
+void *__wrap_malloc(size_t size){
+	allocations++;
+	return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t n, size_t size){
+	allocations++;
+	return __real_calloc(n, size);
+}
+
+void *__wrap_realloc(void *p, size_t size){
+	allocations++;
+	return __real_realloc(p, size);
+}
+
+static double now_ns(void){
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// Live entities used by the current case, and the points tested against them
+static unsigned char ids[ENTITY_COUNT];
+static int id_count;
+static int points_x[POINTS], points_y[POINTS];
+
+// Spawns the first n pool entries, spread over a square dense enough for density
+static void place(int n, double density){
+	init_sprites();
+	srand(1);
+
+	double area = 0;
+	for (int i = 0; i < n; i++) area += entity_mask[i]->width * entity_mask[i]->height;
+	int side = (int)ceil(sqrt(area / density));
+	int side_x = side > LCD_X - 2 ? LCD_X - 2 : side;
+	int side_y = side > LCD_Y - 11 ? LCD_Y - 11 : side;
+
+	for (int i = 0; i < n; i++){
+		ids[i] = i;
+		spawn(i);
+		place_entity(i, 1 + rand() % side_x, 10 + rand() % side_y);
+		entity_dx[i] = rand() % 512 - 256;
+		entity_dy[i] = rand() % 512 - 256;
+	}
+	id_count = n;
+
+	for (int p = 0; p < POINTS; p++){
+		points_x[p] = 1 + rand() % (side_x + 4);
+		points_y[p] = 10 + rand() % (side_y + 4);
+	}
+}
+
+// One pass over a kernel; returns the ops it did
+typedef unsigned long (*Pass)(void);
+
+static unsigned long pass_sprite(void){
+	unsigned long hits = 0, ops = 0;
+	for (int i = 0; i < id_count; i++){
+		for (int j = i + 1; j < id_count; j++){
+			hits += has_collided_sprite(ids[i], ids[j]);
+			ops++;
+		}
+	}
+	sink += hits;
+	return ops;
+}
+
+static unsigned long pass_coords(void){
+	unsigned long hits = 0;
+	for (int i = 0; i < id_count; i++){
+		for (int p = 0; p < POINTS; p++){
+			hits += has_collided_coords(ids[i], points_x[p], points_y[p]);
+		}
+	}
+	sink += hits;
+	return (unsigned long)id_count * POINTS;
+}
+
+// Velocities flip every pass so the entities oscillate rather than drift off
+static unsigned long pass_step(void){
+	unsigned long moved = 0;
+	for (int i = 0; i < id_count; i++){
+		moved += sprite_step(ids[i]);
+		entity_dx[ids[i]] = -entity_dx[ids[i]];
+		entity_dy[ids[i]] = -entity_dy[ids[i]];
+	}
+	sink += moved;
+	return id_count;
+}
+
+static unsigned long pass_aim(void){
+	for (int degrees = 0; degrees < 360; degrees += 5){
+		draw_aim_line(degrees);
+	}
+	reset_changes();
+	return 72;
+}
+
+static unsigned long pass_clear(void){
+	clear_game_screen();
+	return 1;
+}
+
+static unsigned long pass_blit(void){
+	for (int i = 0; i < id_count; i++){
+		draw_entity(ids[i]);
+	}
+	reset_changes();
+	return id_count;
+}
+
+static void run(const char *name, Pass pass, int entities, double density){
+	if (result_count == CASES_MAX) return;
+
+	// Size a run to about RUN_NS, then keep the fastest of RUNS
+	unsigned long passes = 1;
+	for (;;){
+		double start = now_ns();
+		for (unsigned long i = 0; i < passes; i++) pass();
+		if (now_ns() - start > RUN_NS / 10 || passes > (1UL << 30)) break;
+		passes *= 2;
+	}
+	passes *= 10;
+
+	double best = 1e300;
+	unsigned long ops = 0, allocs = 0;
+	for (int r = 0; r < RUNS; r++){
+		unsigned long before = allocations;
+		ops = 0;
+		double start = now_ns();
+		for (unsigned long i = 0; i < passes; i++) ops += pass();
+		double ns = now_ns() - start;
+		allocs = allocations - before;
+		if (ops && ns / ops < best) best = ns / ops;
+	}
+
+	Result *result = &results[result_count++];
+	snprintf(result->name, sizeof(result->name), "%s", name);
+	result->entities = entities;
+	result->density = density;
+	result->ns_per_op = best;
+	result->allocs_per_op = ops ? (double)allocs / ops : 0;
+
+	fprintf(stderr, "%-20s entities %2d density %.2f  %9.2f ns/op  %.3f allocs/op\n",
+		name, entities, density, best, result->allocs_per_op);
+}
+
+static void write_json(FILE *f){
+	fprintf(f, "[\n");
+	for (int i = 0; i < result_count; i++){
+		Result *r = &results[i];
+		fprintf(f, "  {\"name\": \"%s\", \"entities\": %d, \"density\": %.2f, \"ns_per_op\": %.3f, \"allocs_per_op\": %.3f}%s\n",
+			r->name, r->entities, r->density, r->ns_per_op, r->allocs_per_op, i + 1 < result_count ? "," : "");
+	}
+	fprintf(f, "]\n");
+}
+
+// Reads back what write_json() wrote, one case per line
+static int compare(const char *path, double tolerance){
+	FILE *f = fopen(path, "r");
+	if (!f){
+		perror(path);
+		return 2;
+	}
+
+	int status = 0, matched = 0;
+	char line[256];
+	while (fgets(line, sizeof(line), f)){
+		Result base;
+		if (sscanf(line, " {\"name\": \"%31[^\"]\", \"entities\": %d, \"density\": %lf, \"ns_per_op\": %lf",
+			base.name, &base.entities, &base.density, &base.ns_per_op) != 4) continue;
+
+		for (int i = 0; i < result_count; i++){
+			Result *r = &results[i];
+			if (strcmp(r->name, base.name) || r->entities != base.entities || fabs(r->density - base.density) > 0.005) continue;
+
+			double change = (r->ns_per_op / base.ns_per_op - 1) * 100;
+			int slower = change > tolerance;
+			printf("%-20s entities %2d density %.2f  %9.2f -> %9.2f ns/op  %+6.1f%%%s\n", r->name, r->entities,
+				r->density, base.ns_per_op, r->ns_per_op, change, slower ? "  SLOWER" : "");
+			if (slower) status = 1;
+			matched++;
+		}
+	}
+	fclose(f);
+
+	if (!matched){
+		fprintf(stderr, "%s: no cases in common\n", path);
+		return 2;
+	}
+	return status;
+}
+
+static void usage(const char *name){
+	fprintf(stderr, "usage: %s [-e entities] [-d density] [-o results.json] [-b baseline.json] [-t percent]\n", name);
+	exit(2);
+}
+
+int main(int argc, char **argv){
+	int entity_counts[] = { 4, ENTITY_COUNT };
+	double densities[] = { 0.05, 0.3, 1.0 };
+	int entity_cases = 2, density_cases = 3;
+	const char *out = 0, *baseline = 0;
+	double tolerance = 10;
+
+	for (int i = 1; i < argc; i++){
+		if (!strcmp(argv[i], "-e") && i + 1 < argc){
+			entity_counts[0] = atoi(argv[++i]);
+			entity_cases = 1;
+			if (entity_counts[0] < 1 || entity_counts[0] > ENTITY_COUNT){
+				fprintf(stderr, "entities must be 1 to %d, the pool's size\n", ENTITY_COUNT);
+				return 2;
+			}
+		}
+		else if (!strcmp(argv[i], "-d") && i + 1 < argc){
+			densities[0] = atof(argv[++i]);
+			density_cases = 1;
+			if (densities[0] <= 0) usage(argv[0]);
+		}
+		else if (!strcmp(argv[i], "-o") && i + 1 < argc) out = argv[++i];
+		else if (!strcmp(argv[i], "-b") && i + 1 < argc) baseline = argv[++i];
+		else if (!strcmp(argv[i], "-t") && i + 1 < argc) tolerance = atof(argv[++i]);
+		else usage(argv[0]);
+	}
+
+	for (int e = 0; e < entity_cases; e++){
+		for (int d = 0; d < density_cases; d++){
+			place(entity_counts[e], densities[d]);
+			run("has_collided_sprite", pass_sprite, entity_counts[e], densities[d]);
+			run("has_collided_coords", pass_coords, entity_counts[e], densities[d]);
+			run("sprite_step", pass_step, entity_counts[e], densities[d]);
+			run("blit", pass_blit, entity_counts[e], densities[d]);
+		}
+	}
+
+	// Independent of the entities
+	place(1, 1.0);
+	run("draw_aim_line", pass_aim, 1, 1.0);
+	run("clear_game_screen", pass_clear, 0, 0);
+
+	if (out){
+		FILE *f = fopen(out, "w");
+		if (!f){
+			perror(out);
+			return 2;
+		}
+		write_json(f);
+		fclose(f);
+	}
+	else if (!baseline) write_json(stdout);
+
+	return baseline ? compare(baseline, tolerance) : 0;
+}
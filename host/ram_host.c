@@ -0,0 +1,11 @@
+#include "ram.h"
+
+// Host stand-in for ram.c: there is no fixed SRAM to measure.
+
+uint16_t ram_free(void){
+	return 0;
+}
+
+uint16_t ram_stack_headroom(void){
+	return 0;
+}
@@ -0,0 +1,183 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <util/delay.h>
+
+#include "sim.h"
+
+volatile uint8_t DDRB, DDRD, DDRF;
+volatile uint8_t PORTB, PORTD, PORTF;
+volatile uint8_t PINB, PIND, PINF;
+
+volatile uint8_t TCCR0A, TCCR0B, TIMSK0, TCNT0;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1, TIFR1;
+volatile uint16_t TCNT1;
+volatile uint8_t TCCR3A, TCCR3B, TIMSK3;
+volatile uint16_t TCNT3, OCR3A;
+volatile uint8_t TCCR4A, TCCR4B, TIMSK4, TIFR4, TCNT4;
+
+volatile uint8_t ADMUX, ADCSRA, ADCSRB;
+volatile uint16_t ADC;
+
+volatile uint8_t SREG;
+
+uint32_t sim_frame_cycles = SIM_F_CPU / 50;
+uint64_t sim_cycles = 0;
+char sim_echo_serial = 0;
+unsigned long sim_serial_bytes = 0;
+void (*sim_frame_hook)(void) = 0;
+
+void TIMER0_OVF_vect(void);
+void TIMER1_OVF_vect(void);
+void TIMER3_COMPA_vect(void);
+void TIMER4_OVF_vect(void);
+void ADC_vect(void);
+void USB_GEN_vect(void);
+
+// Prescalers match the clock selects written by init_hardware().
+#define T0_PRESCALER 1024
+#define T1_PRESCALER 1024
+#define T3_PRESCALER 1024
+#define T4_PRESCALER 128
+
+// 13 ADC clocks per conversion at the /128 ADC prescaler
+#define ADC_CONVERSION_CYCLES (13 * 128)
+
+// A USB start-of-frame every millisecond
+#define USB_FRAME_CYCLES (SIM_F_CPU / 1000)
+
+static uint32_t t0_residue, t1_residue, t3_residue, t4_residue, adc_residue, usb_residue;
+static uint32_t t4_ticks = 0;
+static uint16_t pot = 0;
+
+// Global interrupt enable lives in SREG, so code that saves and restores
+// SREG around cli() behaves as on the AVR.
+#define SREG_I 7
+
+void sei(void){
+	SREG |= 1 << SREG_I;
+}
+
+void cli(void){
+	SREG &= ~(1 << SREG_I);
+}
+
+/*
+*	Scripted session, sampled once per TIMER4 overflow (~244 Hz).
+*	The fire button is tapped a few times a second, the d-pad walks a fixed
+*	pattern and the aim pot sweeps back and forth.
+*/
+static void script_inputs(){
+	uint32_t t = t4_ticks;
+
+	PINB = PIND = PINF = 0;
+
+	if (t % 61 < 12) PINF |= 1 << PF6;
+
+	switch ((t / 97) % 8){
+		case 0: PINB |= 1 << PB1; break;
+		case 2: PIND |= 1 << PD1; break;
+		case 4: PIND |= 1 << PD0; break;
+		case 6: PINB |= 1 << PB7; break;
+		default: break;
+	}
+
+	uint32_t sweep = t % 2048;
+	pot = sweep < 1024 ? sweep : 2047 - sweep;
+}
+
+static void fire(void (*isr)(void), char enabled){
+	// Interrupts are disabled on entry and re-enabled by RETI, as on the AVR.
+	if (!enabled || !(SREG & (1 << SREG_I))) return;
+	cli();
+	isr();
+	sei();
+}
+
+// Run every timer forward by at most one TIMER4 period.
+static void step(uint32_t cycles){
+	sim_cycles += cycles;
+
+	t0_residue += cycles;
+	uint32_t t0 = TCNT0 + t0_residue / T0_PRESCALER;
+	t0_residue %= T0_PRESCALER;
+	TCNT0 = t0 & 0xFF;
+
+	t1_residue += cycles;
+	uint32_t t1 = TCNT1 + t1_residue / T1_PRESCALER;
+	t1_residue %= T1_PRESCALER;
+	TCNT1 = t1 & 0xFFFF;
+
+	t3_residue += cycles;
+	uint32_t t3 = TCNT3 + t3_residue / T3_PRESCALER;
+	t3_residue %= T3_PRESCALER;
+	char t3_match = OCR3A && t3 > OCR3A;
+	TCNT3 = t3_match ? t3 - OCR3A - 1 : t3;
+
+	t4_residue += cycles;
+	uint32_t t4 = TCNT4 + t4_residue / T4_PRESCALER;
+	t4_residue %= T4_PRESCALER;
+	TCNT4 = t4 & 0xFF;
+
+	// Conversions complete while ADSC is set; free-running mode keeps it set
+	if ((ADCSRA & (1 << ADEN)) && (ADCSRA & (1 << ADSC))){
+		adc_residue += cycles;
+		while (adc_residue >= ADC_CONVERSION_CYCLES){
+			adc_residue -= ADC_CONVERSION_CYCLES;
+			ADC = pot;
+			if (!(ADCSRA & (1 << ADATE))) ADCSRA &= ~(1 << ADSC);
+			ADCSRA |= 1 << ADIF;
+			if ((ADCSRA & (1 << ADIE)) && (SREG & (1 << SREG_I))){
+				ADCSRA &= ~(1 << ADIF);
+				fire(ADC_vect, 1);
+			}
+			if (!(ADCSRA & (1 << ADSC))) break;
+		}
+	}
+
+	usb_residue += cycles;
+	while (usb_residue >= USB_FRAME_CYCLES){
+		usb_residue -= USB_FRAME_CYCLES;
+		fire(USB_GEN_vect, 1);
+	}
+
+	if (t0 > 0xFF) fire(TIMER0_OVF_vect, TIMSK0 & (1 << TOIE0));
+	if (t1 > 0xFFFF) fire(TIMER1_OVF_vect, TIMSK1 & (1 << TOIE1));
+	if (t3_match) fire(TIMER3_COMPA_vect, TIMSK3 & (1 << OCIE3A));
+	if (t4 > 0xFF){
+		t4_ticks++;
+		script_inputs();
+		fire(TIMER4_OVF_vect, TIMSK4 & (1 << TOIE4));
+	}
+}
+
+void sim_advance(uint32_t cycles){
+	const uint32_t t4_period = 256UL * T4_PRESCALER;
+	while (cycles){
+		uint32_t to_t4 = (256 - TCNT4) * T4_PRESCALER - t4_residue;
+		uint32_t n = cycles < to_t4 ? cycles : to_t4;
+		if (n > t4_period) n = t4_period;
+		step(n);
+		cycles -= n;
+	}
+}
+
+void sim_show_screen(void){
+	if (sim_frame_hook) sim_frame_hook();
+	sim_advance(sim_frame_cycles);
+}
+
+// The game's partial LCD push (screen.c, built as real_show_changes)
+void real_show_changes(void);
+
+void show_changes(void){
+	sim_show_screen();
+	real_show_changes();
+}
+
+void _delay_ms(double ms){
+	sim_advance((uint32_t)(ms * (SIM_F_CPU / 1000)));
+}
+
+void _delay_us(double us){
+	sim_advance((uint32_t)(us * (SIM_F_CPU / 1000000)));
+}
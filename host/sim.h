@@ -0,0 +1,30 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+/*
+*	Virtual ATmega32U4 for the host build.
+*	Time only moves when the game pushes a frame to the LCD or delays, so a
+*	scripted session is deterministic no matter how fast the host runs.
+*/
+
+#include <stdint.h>
+
+#define SIM_F_CPU 8000000UL
+
+// Virtual CPU cycles charged for each frame pushed to the LCD.
+extern uint32_t sim_frame_cycles;
+
+// Total virtual cycles elapsed since boot.
+extern uint64_t sim_cycles;
+
+// Echo bytes written to the USB serial port to stdout.
+extern char sim_echo_serial;
+extern unsigned long sim_serial_bytes;
+
+// Called at the start of every frame push, before virtual time advances.
+extern void (*sim_frame_hook)(void);
+
+void sim_advance(uint32_t cycles);
+void sim_show_screen(void);
+
+#endif
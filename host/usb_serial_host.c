@@ -0,0 +1,75 @@
+#include <stdio.h>
+
+#include <avr/interrupt.h>
+
+#include "usb_serial.h"
+#include "tx_queue.h"
+#include "sim.h"
+
+// Host stand-in for usb_serial.c: always enumerated, nothing ever received.
+
+// Start of frame, raised by the simulator every millisecond
+ISR(USB_GEN_vect){
+	tx_queue_drain(64);
+}
+
+void usb_init(void){
+}
+
+uint8_t usb_configured(void){
+	return 1;
+}
+
+int16_t usb_serial_getchar(void){
+	return -1;
+}
+
+uint8_t usb_serial_available(void){
+	return 0;
+}
+
+void usb_serial_flush_input(void){
+}
+
+int8_t usb_serial_putchar(uint8_t c){
+	sim_serial_bytes++;
+	if (sim_echo_serial) putchar(c);
+	return 0;
+}
+
+int8_t usb_serial_putchar_nowait(uint8_t c){
+	return usb_serial_putchar(c);
+}
+
+int8_t usb_serial_write(const uint8_t *buffer, uint16_t size){
+	while (size--) usb_serial_putchar(*buffer++);
+	return 0;
+}
+
+void usb_serial_flush_output(void){
+}
+
+uint32_t usb_serial_get_baud(void){
+	return 9600;
+}
+
+uint8_t usb_serial_get_stopbits(void){
+	return USB_SERIAL_1_STOP;
+}
+
+uint8_t usb_serial_get_paritytype(void){
+	return USB_SERIAL_PARITY_NONE;
+}
+
+uint8_t usb_serial_get_numbits(void){
+	return 8;
+}
+
+uint8_t usb_serial_get_control(void){
+	return USB_SERIAL_DTR | USB_SERIAL_RTS;
+}
+
+int8_t usb_serial_set_control(uint8_t signals){
+	(void)signals;
+	return 0;
+}
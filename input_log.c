@@ -0,0 +1,154 @@
+#include "input_log.h"
+
+#define RECORD_REPEAT 0x80
+#define RECORD_SEED 0x40
+#define FIELD_BUTTONS 0x01
+#define FIELD_AIM_DELTA 0x02
+#define FIELD_AIM 0x04
+#define FIELD_SERIAL 0x08
+#define FIELD_FIRES 0x10
+#define FIELD_TICKS 0x20
+
+#define REPEAT_MAX 0x7F
+
+// What a step repeats when nothing is recorded for it
+static void reset_frame(InputFrame *frame){
+	frame->buttons = 0;
+	frame->fires = 0;
+	frame->serial = -1;
+	frame->aim = 0;
+	frame->ticks = 0;
+}
+
+static uint8_t put16(uint8_t *out, uint16_t value){
+	out[0] = value;
+	out[1] = value >> 8;
+	return 2;
+}
+
+uint8_t input_record_flush(InputRecorder *rec, uint8_t *out){
+	if (!rec->repeat) return 0;
+	out[0] = RECORD_REPEAT | rec->repeat;
+	rec->repeat = 0;
+	return 1;
+}
+
+uint8_t input_record_seed(InputRecorder *rec, uint16_t seed, uint8_t *out){
+	uint8_t n = input_record_flush(rec, out);
+	out[n++] = RECORD_SEED;
+	n += put16(&out[n], seed);
+	reset_frame(&rec->last);
+	return n;
+}
+
+uint8_t input_record_step(InputRecorder *rec, const InputFrame *frame, uint8_t *out){
+	InputFrame *last = &rec->last;
+	uint8_t flags = 0;
+	int16_t aim_delta = frame->aim - last->aim;
+
+	if (frame->buttons != last->buttons) flags |= FIELD_BUTTONS;
+	if (aim_delta >= -128 && aim_delta <= 127){
+		if (aim_delta) flags |= FIELD_AIM_DELTA;
+	}
+	else flags |= FIELD_AIM;
+	if (frame->serial >= 0) flags |= FIELD_SERIAL;
+	if (frame->fires) flags |= FIELD_FIRES;
+	if (frame->ticks != last->ticks) flags |= FIELD_TICKS;
+
+	if (!flags){
+		if (++rec->repeat < REPEAT_MAX) return 0;
+		return input_record_flush(rec, out);
+	}
+
+	uint8_t n = input_record_flush(rec, out);
+	out[n++] = flags;
+	if (flags & FIELD_BUTTONS) out[n++] = frame->buttons;
+	if (flags & FIELD_AIM_DELTA) out[n++] = aim_delta;
+	if (flags & FIELD_AIM) n += put16(&out[n], frame->aim);
+	if (flags & FIELD_SERIAL) out[n++] = frame->serial;
+	if (flags & FIELD_FIRES) out[n++] = frame->fires;
+	if (flags & FIELD_TICKS){
+		if (frame->ticks < 0xFF) out[n++] = frame->ticks;
+		else {
+			out[n++] = 0xFF;
+			n += put16(&out[n], frame->ticks);
+		}
+	}
+
+	// Events happen once; only the state carries over to a repeat
+	*last = *frame;
+	last->serial = -1;
+	last->fires = 0;
+	return n;
+}
+
+#ifdef INPUT_REPLAY
+
+void input_play_open(InputPlayer *play, const uint8_t *data, uint32_t size){
+	play->data = data;
+	play->size = size;
+	play->at = 0;
+	play->repeat = 0;
+	reset_frame(&play->last);
+}
+
+uint8_t input_play_done(const InputPlayer *play){
+	return play->at >= play->size && !play->repeat;
+}
+
+static uint8_t get8(InputPlayer *play){
+	return play->at < play->size ? play->data[play->at++] : 0;
+}
+
+static uint16_t get16(InputPlayer *play){
+	uint16_t low = get8(play);
+	return low | (uint16_t)get8(play) << 8;
+}
+
+uint8_t input_play_seed(InputPlayer *play, uint16_t *seed){
+	InputFrame frame;
+	while (input_play_step(play, &frame));
+
+	if (play->at >= play->size) return 0;
+	play->at++;
+	*seed = get16(play);
+	reset_frame(&play->last);
+	return 1;
+}
+
+uint8_t input_play_step(InputPlayer *play, InputFrame *frame){
+	if (play->repeat){
+		play->repeat--;
+		*frame = play->last;
+		return 1;
+	}
+	if (play->at >= play->size) return 0;
+
+	uint8_t flags = play->data[play->at];
+	if (flags == RECORD_SEED) return 0;
+	play->at++;
+
+	if (flags & RECORD_REPEAT){
+		play->repeat = (flags & REPEAT_MAX) - 1;
+		*frame = play->last;
+		return 1;
+	}
+
+	*frame = play->last;
+	if (flags & FIELD_BUTTONS) frame->buttons = get8(play);
+	if (flags & FIELD_AIM_DELTA) frame->aim += (int8_t)get8(play);
+	if (flags & FIELD_AIM) frame->aim = get16(play);
+	if (flags & FIELD_SERIAL) frame->serial = get8(play);
+	if (flags & FIELD_FIRES) frame->fires = get8(play);
+	if (flags & FIELD_TICKS){
+		frame->ticks = get8(play);
+		if (frame->ticks == 0xFF) frame->ticks = get16(play);
+	}
+
+	play->last = *frame;
+	play->last.serial = -1;
+	play->last.fires = 0;
+	return 1;
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef input_log_h__
+#define input_log_h__
+
+/*
+*	Compact log of everything the simulation reads from outside, one entry
+*	per fixed step, so a session can be replayed exactly.
+*
+*	Each game starts with a seed record. A step record is a flags byte
+*	followed by only the fields that changed; steps identical to the one
+*	before collapse into run-length bytes:
+*
+*		0x80 | n	n (1..127) more steps like the last
+*		0x40, u16	new game, RNG seed
+*		otherwise	step, flags then fields in this order:
+*		  0x01 u8	buttons
+*		  0x02 s8	aim, change in degrees
+*		  0x04 u16	aim, degrees
+*		  0x08 u8	serial byte
+*		  0x10 u8	fire presses
+*		  0x20 u8	ticks, 0xFF then u16 if larger
+*
+*	Multi-byte fields are little-endian.
+*/
+
+#include <stdint.h>
+
+#define INPUT_RECORD_MAX 12	// most bytes one call can produce
+
+typedef struct {
+	uint8_t buttons;	// held buttons, one bit each
+	uint8_t fires;		// fire button releases since the last step
+	int16_t serial;		// usb_serial_getchar(), -1 for none
+	uint16_t aim;		// degrees
+	uint16_t ticks;		// timer wheel ticks since the last step
+} InputFrame;
+
+typedef struct {
+	InputFrame last;
+	uint8_t repeat;
+} InputRecorder;
+
+// Each returns the bytes written to out, at most INPUT_RECORD_MAX
+uint8_t input_record_seed(InputRecorder *rec, uint16_t seed, uint8_t *out);
+uint8_t input_record_step(InputRecorder *rec, const InputFrame *frame, uint8_t *out);
+uint8_t input_record_flush(InputRecorder *rec, uint8_t *out);
+
+#ifdef INPUT_REPLAY
+
+typedef struct {
+	const uint8_t *data;
+	uint32_t size, at;
+	InputFrame last;
+	uint8_t repeat;
+} InputPlayer;
+
+void input_play_open(InputPlayer *play, const uint8_t *data, uint32_t size);
+
+// next game's seed, skipping any steps left over; 0 at the end of the log
+uint8_t input_play_seed(InputPlayer *play, uint16_t *seed);
+
+// next step; 0 at the end of the log or of the game
+uint8_t input_play_step(InputPlayer *play, InputFrame *frame);
+
+uint8_t input_play_done(const InputPlayer *play);
+
+#endif
+
+#endif
@@ -0,0 +1,5 @@
+#include "input_queue.h"
+
+InputEvent input_queue[INPUT_QUEUE_SIZE];
+volatile uint8_t input_queue_head = 0;
+volatile uint8_t input_queue_tail = 0;
@@ -0,0 +1,70 @@
+#ifndef input_queue_h__
+#define input_queue_h__
+
+/*
+*	Button events from the debounce interrupt to the main loop.
+*
+*	A single-producer, single-consumer ring: only the interrupt moves the
+*	head and only the main loop moves the tail, so neither side needs to
+*	turn interrupts off. Each index is one byte and so is read and written
+*	whole. The producer writes the event before publishing it by moving
+*	the head; a full ring drops the new event.
+*/
+
+#include <stdint.h>
+
+#define INPUT_QUEUE_SIZE 16	// events, a power of two
+
+enum {
+	INPUT_PRESS,	// button went down
+	INPUT_RELEASE,	// button came up
+	INPUT_FIRE	// a fire button came up; angle is the aim then
+};
+
+typedef struct {
+	uint8_t type;
+	uint8_t button;
+	int16_t angle;
+	uint16_t tick;	// timer_ticks when it was queued
+} InputEvent;
+
+extern InputEvent input_queue[INPUT_QUEUE_SIZE];
+extern volatile uint8_t input_queue_head;
+extern volatile uint8_t input_queue_tail;
+
+// Keeps the compiler from moving the event copy across the index update
+#define INPUT_QUEUE_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+// the producer, from one interrupt; 0 on success, -1 if the ring was full
+static inline int8_t input_queue_push(uint8_t type, uint8_t button, int16_t angle, uint16_t tick){
+	uint8_t head = input_queue_head;
+	if ((uint8_t)(head - input_queue_tail) == INPUT_QUEUE_SIZE) return -1;
+
+	InputEvent *event = &input_queue[head & (INPUT_QUEUE_SIZE - 1)];
+	event->type = type;
+	event->button = button;
+	event->angle = angle;
+	event->tick = tick;
+	INPUT_QUEUE_BARRIER();
+	input_queue_head = head + 1;
+	return 0;
+}
+
+// the consumer, from the main loop; 1 and the oldest event, or 0 if empty
+static inline uint8_t input_queue_pop(InputEvent *event){
+	uint8_t tail = input_queue_tail;
+	if (tail == input_queue_head) return 0;
+
+	INPUT_QUEUE_BARRIER();
+	*event = input_queue[tail & (INPUT_QUEUE_SIZE - 1)];
+	INPUT_QUEUE_BARRIER();
+	input_queue_tail = tail + 1;
+	return 1;
+}
+
+// the consumer drops everything queued so far
+static inline void input_queue_flush(void){
+	input_queue_tail = input_queue_head;
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifdef PROFILE
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "timer_wheel.h"
+#include "telemetry.h"
+#include "profile.h"
+
+typedef struct {
+	uint16_t min, max;
+	uint32_t sum;
+	uint16_t count;
+	uint16_t buckets[PROFILE_BUCKETS];
+} Phase;
+
+typedef struct {
+	uint32_t entries;
+	uint16_t max;
+} Handler;
+
+static Phase phases[PHASE_COUNT];
+static uint16_t last_lap;
+static uint16_t frames;
+
+static Handler handlers[ISR_COUNT];
+
+// TIMER4 as one 16 us count, wrapping every second or so
+static uint16_t profile_now(void){
+	uint8_t sreg = SREG;
+	cli();
+	uint8_t low = TCNT4;
+	uint16_t high = timer_ticks;
+
+	// Overflowed since interrupts went off, but not yet counted
+	if ((TIFR4 & (1 << TOV4)) && low < 0x80) high++;
+	SREG = sreg;
+	return high << 8 | low;
+}
+
+static void reset(Phase *phase){
+	phase->min = 0;
+	phase->max = 0;
+	phase->sum = 0;
+	phase->count = 0;
+	for (uint8_t b = 0; b < PROFILE_BUCKETS; b++) phase->buckets[b] = 0;
+}
+
+void profile_mark(void){
+	last_lap = profile_now();
+}
+
+void profile_lap(uint8_t phase){
+	uint16_t now = profile_now();
+	uint16_t counts = now - last_lap;
+	last_lap = now;
+
+	Phase *p = &phases[phase];
+	if (!p->count || counts < p->min) p->min = counts;
+	if (counts > p->max) p->max = counts;
+	p->sum += counts;
+	p->count++;
+
+	// Bucket 0 is under one count, bucket b under 2^b counts
+	uint8_t bucket = 0;
+	while (counts && bucket < PROFILE_BUCKETS - 1){
+		counts >>= 1;
+		bucket++;
+	}
+	p->buckets[bucket]++;
+}
+
+// Interrupts are off throughout a handler
+uint16_t profile_isr_enter(void){
+	return profile_now();
+}
+
+void profile_isr_exit(uint8_t isr, uint16_t entered){
+	uint16_t counts = profile_now() - entered;
+	Handler *h = &handlers[isr];
+	h->entries++;
+	if (counts > h->max) h->max = counts;
+}
+
+// isr, uint32 entries, uint16 longest in counts
+static void report_isr(profile_emit emit, uint8_t isr){
+	uint8_t sreg = SREG;
+	cli();
+	Handler h = handlers[isr];
+	handlers[isr].entries = 0;
+	handlers[isr].max = 0;
+	SREG = sreg;
+
+	uint8_t report[7] = {
+		isr,
+		h.entries, h.entries >> 8, h.entries >> 16, h.entries >> 24,
+		h.max, h.max >> 8
+	};
+	emit(EVENT_ISR, report, sizeof(report));
+}
+
+// One phase or handler a frame, so a report never floods the serial queue;
+// each still covers PROFILE_EVERY frames, just staggered by a frame
+void profile_frame(profile_emit emit){
+	if (++frames < PROFILE_EVERY) return;
+
+	uint8_t p = frames - PROFILE_EVERY;
+	if (p == PHASE_COUNT + ISR_COUNT - 1) frames = PHASE_COUNT + ISR_COUNT - 1;
+	if (p >= PHASE_COUNT){
+		report_isr(emit, p - PHASE_COUNT);
+		return;
+	}
+	Phase *phase = &phases[p];
+	if (!phase->count) return;
+
+	// phase, min/avg/max in counts, then each bucket's share in percent
+	uint8_t report[7 + PROFILE_BUCKETS];
+	uint16_t avg = phase->sum / phase->count;
+	report[0] = p;
+	report[1] = phase->min;
+	report[2] = phase->min >> 8;
+	report[3] = avg;
+	report[4] = avg >> 8;
+	report[5] = phase->max;
+	report[6] = phase->max >> 8;
+	for (uint8_t b = 0; b < PROFILE_BUCKETS; b++){
+		report[7 + b] = (uint32_t)phase->buckets[b] * 100 / phase->count;
+	}
+	emit(EVENT_PROFILE, report, sizeof(report));
+	reset(phase);
+}
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef profile_h__
+#define profile_h__
+
+/*
+*	Per-phase frame profiler, built only with -DPROFILE; otherwise the
+*	macros below are empty and nothing is compiled in.
+*
+*	PROFILE_LAP(phase) charges the time since the previous lap (or
+*	PROFILE_MARK()) to phase, so laps placed back to back split a frame
+*	with nothing left over.
+*	Time is TIMER4 (16 us counts, extended by its overflow count). Each
+*	phase keeps min/avg/max and a histogram of power-of-two buckets
+*	(< 16 us, < 32 us, ... , >= 1 ms). PROFILE_FRAME(emit) ends a frame;
+*	every PROFILE_EVERY frames each phase sends one EVENT_PROFILE through
+*	emit, a send_event()-like function, and starts over.
+*
+*	PROFILE_ISR_ENTER() and PROFILE_ISR_EXIT(isr) bracket an interrupt
+*	handler, counting its entries and its longest run; those go out as one
+*	EVENT_ISR per handler after the phases. No handler here turns
+*	interrupts back on, so they never nest and a run is never inflated
+*	by another handler's time.
+*/
+
+#include <stdint.h>
+
+#ifndef PROFILE_EVERY
+#define PROFILE_EVERY 256	// frames, more than PHASE_COUNT + ISR_COUNT
+#endif
+
+#define PROFILE_BUCKETS 8
+#define PROFILE_US_PER_COUNT 16
+
+enum {
+	PHASE_TIME,		// process_time()
+	PHASE_INPUT,		// read_inputs(), timers, process_input()
+	PHASE_MOVE,		// step_sprites(), check_alien_wall()
+	PHASE_COLLISION,	// check_collision()
+	PHASE_RULES,		// the rest of step_game()
+	PHASE_ERASE,		// erase_drawn()
+	PHASE_STATUS,		// draw_status_border()
+	PHASE_SPRITES,		// draw_entity(), draw_sprites()
+	PHASE_AIM,		// draw_aim_line()
+	PHASE_SHOW,		// show_changes()
+	PHASE_COUNT
+};
+
+enum {
+	ISR_TIMER4,		// button debounce, timer wheel tick
+	ISR_ADC,		// aim pot
+	ISR_TIMER3,		// send_status()
+	ISR_TIMER1,		// debug clock overflow
+	ISR_TIMER0,		// game clock overflow
+	ISR_USB_GEN,		// USB start of frame, serial transmit
+	ISR_USB_COM,		// USB control requests on endpoint 0
+	ISR_COUNT
+};
+
+#ifdef PROFILE
+
+typedef void (*profile_emit)(uint8_t event, const void *payload, uint8_t size);
+
+void profile_mark(void);
+void profile_lap(uint8_t phase);
+void profile_frame(profile_emit emit);
+uint16_t profile_isr_enter(void);
+void profile_isr_exit(uint8_t isr, uint16_t entered);
+
+#define PROFILE_MARK() profile_mark()
+#define PROFILE_LAP(phase) profile_lap(phase)
+#define PROFILE_FRAME(emit) profile_frame(emit)
+#define PROFILE_ISR_ENTER() uint16_t profile_entered = profile_isr_enter()
+#define PROFILE_ISR_EXIT(isr) profile_isr_exit(isr, profile_entered)
+
+#else
+
+#define PROFILE_MARK()
+#define PROFILE_LAP(phase)
+#define PROFILE_FRAME(emit)
+#define PROFILE_ISR_ENTER()
+#define PROFILE_ISR_EXIT(isr)
+
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+#include <avr/io.h>
+
+#include "ram.h"
+
+// From the avr-libc linker script and malloc()
+extern uint8_t __heap_start;
+extern uint8_t *__brkval;
+extern uint8_t __stack;
+
+// Runs in .init3: the stack pointer and zero register are set, nothing has
+// been called yet, and .data and .bss (below __heap_start) don't matter
+void ram_paint(void) __attribute__((naked, used, section(".init3")));
+
+void ram_paint(void){
+	for (uint8_t *p = &__heap_start; p <= &__stack; p++) *p = RAM_PAINT;
+}
+
+static uint8_t *heap_top(void){
+	return __brkval ? __brkval : &__heap_start;
+}
+
+uint16_t ram_free(void){
+	uint8_t here;
+	return &here - heap_top();
+}
+
+uint16_t ram_stack_headroom(void){
+	uint8_t *bottom = heap_top();
+	uint8_t *p = bottom;
+	while (p <= &__stack && *p == RAM_PAINT) p++;
+	return p - bottom;
+}
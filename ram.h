@@ -0,0 +1,32 @@
+#ifndef ram_h__
+#define ram_h__
+
+/*
+*	SRAM probes.
+*
+*	The 32U4 has 2.5 KB of SRAM shared by .data, .bss, the heap and the
+*	stack. ram_free() is the gap between the top of the heap (or the end
+*	of .bss when nothing was allocated) and the stack pointer, measured
+*	from wherever it is called.
+*
+*	At boot, before main(), everything from the end of .bss to the top of
+*	RAM is painted with RAM_PAINT. ram_stack_headroom() counts the painted
+*	bytes still intact above the heap, which is how close the stack has
+*	come to it at its deepest since boot, interrupts included. It scans
+*	that gap, so call it now and then from the main loop, not an ISR.
+*
+*	The host build has nothing to measure and reports 0 for both; see
+*	make -C host ram-report for the static side.
+*/
+
+#include <stdint.h>
+
+#define RAM_PAINT 0xC5
+
+// bytes between the heap and the stack right now
+uint16_t ram_free(void);
+
+// bytes between the heap and the deepest the stack has reached
+uint16_t ram_stack_headroom(void);
+
+#endif
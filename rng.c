@@ -0,0 +1,42 @@
+#include "rng.h"
+
+static uint16_t state[RNG_STREAMS];
+
+void rng_seed(uint16_t seed){
+	for (uint8_t i = 0; i < RNG_STREAMS; i++){
+		// Spread the streams apart; xorshift state must never be 0
+		uint16_t s = seed ^ (0x9E37 * (i + 1));
+		state[i] = s ? s : 0x2545;
+		rng_next(i);
+		rng_next(i);
+	}
+}
+
+// xorshift16 with shifts 7, 9, 8: period 65535
+uint16_t rng_next(uint8_t stream){
+	uint16_t x = state[stream];
+	x ^= x << 7;
+	x ^= x >> 9;
+	x ^= x << 8;
+	state[stream] = x;
+	return x;
+}
+
+uint16_t rng_below(uint8_t stream, uint16_t n){
+	uint16_t mask = n - 1;
+	mask |= mask >> 1;
+	mask |= mask >> 2;
+	mask |= mask >> 4;
+	mask |= mask >> 8;
+
+	// Fewer than two draws on average
+	uint16_t x;
+	do {
+		x = rng_next(stream) & mask;
+	} while (x >= n);
+	return x;
+}
+
+int16_t rng_range(uint8_t stream, int16_t lo, int16_t hi){
+	return lo + (int16_t)rng_below(stream, (uint16_t)(hi - lo) + 1);
+}
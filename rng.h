@@ -0,0 +1,34 @@
+#ifndef rng_h__
+#define rng_h__
+
+/*
+*	Small random number generator for the game.
+*
+*	Each subsystem draws from its own xorshift stream, so adding a draw in
+*	one doesn't shift what the others see. Everything follows from the seed
+*	passed to rng_seed(), which the game logs so a run can be replayed. The
+*	range helpers reject rather than take a modulo, so they are unbiased and
+*	never divide.
+*/
+
+#include <stdint.h>
+
+enum {
+	RNG_SPAWN,	// spawn positions
+	RNG_AI,		// alien and mothership timing
+	RNG_STREAMS
+};
+
+// restart every stream from seed (any value, including 0)
+void rng_seed(uint16_t seed);
+
+// next 16 bits of stream
+uint16_t rng_next(uint8_t stream);
+
+// uniform in 0..n-1; n must be at least 1
+uint16_t rng_below(uint8_t stream, uint16_t n);
+
+// uniform in lo..hi inclusive; lo <= hi and hi - lo < 65535
+int16_t rng_range(uint8_t stream, int16_t lo, int16_t hi);
+
+#endif
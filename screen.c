@@ -0,0 +1,144 @@
+#include <avr/pgmspace.h>
+
+#include "lcd.h"
+#include "graphics.h"
+
+#include "screen.h"
+
+typedef struct {
+	unsigned char x0, y0, x1, y1;
+} Rect;
+
+// A bank is clean when its min is past its max
+static unsigned char dirty_min[SCREEN_BANKS];
+static unsigned char dirty_max[SCREEN_BANKS];
+
+static Rect drawn[SCREEN_DRAWN_MAX];
+static unsigned char drawn_count = 0;
+
+// Clip to the screen; returns 0 if nothing is left
+static char clip(int* x0, int* y0, int* x1, int* y1){
+	if (*x0 < 0) *x0 = 0;
+	if (*y0 < 0) *y0 = 0;
+	if (*x1 > LCD_X - 1) *x1 = LCD_X - 1;
+	if (*y1 > LCD_Y - 1) *y1 = LCD_Y - 1;
+	return *x0 <= *x1 && *y0 <= *y1;
+}
+
+void mark_dirty(int x0, int y0, int x1, int y1){
+	if (!clip(&x0, &y0, &x1, &y1)) return;
+
+	for (int bank = y0 >> 3; bank <= y1 >> 3; bank++){
+		if (x0 < dirty_min[bank]) dirty_min[bank] = x0;
+		if (x1 > dirty_max[bank]) dirty_max[bank] = x1;
+	}
+}
+
+void mark_drawn(int x0, int y0, int x1, int y1){
+	if (!clip(&x0, &y0, &x1, &y1)) return;
+
+	mark_dirty(x0, y0, x1, y1);
+
+	// Out of slots: grow the last rectangle to cover this one too
+	if (drawn_count == SCREEN_DRAWN_MAX){
+		Rect* last = &drawn[SCREEN_DRAWN_MAX - 1];
+		if (x0 < last->x0) last->x0 = x0;
+		if (y0 < last->y0) last->y0 = y0;
+		if (x1 > last->x1) last->x1 = x1;
+		if (y1 > last->y1) last->y1 = y1;
+		return;
+	}
+	drawn[drawn_count].x0 = x0;
+	drawn[drawn_count].y0 = y0;
+	drawn[drawn_count].x1 = x1;
+	drawn[drawn_count].y1 = y1;
+	drawn_count++;
+}
+
+void clear_rect(int x0, int y0, int x1, int y1){
+	if (!clip(&x0, &y0, &x1, &y1)) return;
+
+	mark_dirty(x0, y0, x1, y1);
+
+	for (int bank = y0 >> 3; bank <= y1 >> 3; bank++){
+		int top = bank == (y0 >> 3) ? (y0 & 7) : 0;
+		int bottom = bank == (y1 >> 3) ? (y1 & 7) : 7;
+		unsigned char keep = ~((0xFF << top) & (0xFF >> (7 - bottom)));
+		unsigned char* column = &screen_buffer[bank * LCD_X + x0];
+		for (int x = x0; x <= x1; x++){
+			*column++ &= keep;
+		}
+	}
+}
+
+void erase_drawn(int clip_x0, int clip_y0, int clip_x1, int clip_y1){
+	for (unsigned char i = 0; i < drawn_count; i++){
+		int x0 = drawn[i].x0 > clip_x0 ? drawn[i].x0 : clip_x0;
+		int y0 = drawn[i].y0 > clip_y0 ? drawn[i].y0 : clip_y0;
+		int x1 = drawn[i].x1 < clip_x1 ? drawn[i].x1 : clip_x1;
+		int y1 = drawn[i].y1 < clip_y1 ? drawn[i].y1 : clip_y1;
+		clear_rect(x0, y0, x1, y1);
+	}
+	drawn_count = 0;
+}
+
+void show_changes(void){
+	for (unsigned char bank = 0; bank < SCREEN_BANKS; bank++){
+		if (dirty_min[bank] > dirty_max[bank]) continue;
+
+		// PCD8544 "set X address" and "set Y address" commands
+		lcd_write(LCD_C, 0x80 | dirty_min[bank]);
+		lcd_write(LCD_C, 0x40 | bank);
+
+		unsigned char* column = &screen_buffer[bank * LCD_X + dirty_min[bank]];
+		for (unsigned char x = dirty_min[bank]; x <= dirty_max[bank]; x++){
+			lcd_write(LCD_D, *column++);
+		}
+
+		dirty_min[bank] = 0xFF;
+		dirty_max[bank] = 0;
+	}
+}
+
+void reset_changes(void){
+	for (unsigned char bank = 0; bank < SCREEN_BANKS; bank++){
+		dirty_min[bank] = 0xFF;
+		dirty_max[bank] = 0;
+	}
+	drawn_count = 0;
+}
+
+void draw_string_P(unsigned char x, unsigned char y, const char* string){
+	char c;
+	while ((c = pgm_read_byte(string++))){
+		draw_char(x, y, c);
+		x += 5;
+	}
+}
+
+void blit(const uint16_t* table, unsigned char width, unsigned char height, int x, int y){
+	if (x >= LCD_X || y >= LCD_Y || x + width <= 0 || y + height <= 0) return;
+
+	// Floor, so a sprite poking above the screen still finds its offset
+	int bank = y >= 0 ? y >> 3 : -((7 - y) >> 3);
+	unsigned char offset = y - bank * 8;
+	uint16_t box = ((1 << height) - 1) << offset;
+	unsigned char first = x < 0 ? -x : 0;
+	unsigned char last = x + width > LCD_X ? LCD_X - x : width;
+
+	const uint16_t* column = table + offset * width;
+	if (bank >= 0){
+		unsigned char keep = ~box;
+		unsigned char* out = &screen_buffer[bank * LCD_X + x + first];
+		for (unsigned char i = first; i < last; i++, out++){
+			*out = (*out & keep) | (unsigned char)pgm_read_word(&column[i]);
+		}
+	}
+	if ((box >> 8) && bank + 1 < SCREEN_BANKS){
+		unsigned char keep = ~(box >> 8);
+		unsigned char* out = &screen_buffer[(bank + 1) * LCD_X + x + first];
+		for (unsigned char i = first; i < last; i++, out++){
+			*out = (*out & keep) | (pgm_read_word(&column[i]) >> 8);
+		}
+	}
+}
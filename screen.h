@@ -0,0 +1,88 @@
+#ifndef screen_h__
+#define screen_h__
+
+/*
+*	Dirty-region tracking for the PCD8544 frame buffer.
+*
+*	The LCD is written in banks of 8 rows, one byte per column, so damage is
+*	kept as a column range per bank. Anything drawn with mark_drawn() is
+*	remembered and cleared again by the next erase_drawn(), which lets a
+*	frame erase and redraw only what moves instead of clearing the screen.
+*	show_changes() then sends just the damaged columns of each bank.
+*/
+
+#include <stdint.h>
+
+#include "lcd.h"
+
+#define SCREEN_BANKS (LCD_Y / 8)
+#define SCREEN_DRAWN_MAX 24
+
+// Mark the inclusive rectangle as changed; it is clipped to the screen
+void mark_dirty(int x0, int y0, int x1, int y1);
+
+// Mark a rectangle that was just drawn, so it is erased next frame
+void mark_drawn(int x0, int y0, int x1, int y1);
+
+// Clear the pixels of every rectangle drawn since the last call, within the given clip
+void erase_drawn(int clip_x0, int clip_y0, int clip_x1, int clip_y1);
+
+// Clear the pixels of a rectangle in the frame buffer and mark it dirty
+void clear_rect(int x0, int y0, int x1, int y1);
+
+// Send only the damaged columns of each bank to the LCD
+void show_changes(void);
+
+// Forget all damage and drawn rectangles, e.g. after a full show_screen()
+void reset_changes(void);
+
+/*
+*	Pre-shifted sprites for blit(). A sprite up to 16 wide and 8 tall is
+*	kept in flash as one word per column for each of the BLIT_OFFSETS rows
+*	it can start on within a bank: the low byte lands in the bank holding
+*	its top row and the high byte in the bank below. BLIT_TABLE() builds
+*	the table at compile time from the same packed rows the sprite library
+*	takes, e.g.
+*
+*		const uint16_t craft_blit[BLIT_OFFSETS][5] PROGMEM = {
+*			BLIT_TABLE(BLIT_COLUMNS5, BLIT_NARROW(CRAFT_ART))
+*		};
+*/
+#define BLIT_OFFSETS 8
+
+// A sprite's rows, one byte (NARROW) or two (WIDE) each, as 8 words with the left column in bit 15
+#define BLIT_NARROW(...) BLIT_NARROW_(__VA_ARGS__, 0, 0, 0, 0, 0, 0, 0, 0)
+#define BLIT_NARROW_(a, b, c, d, e, f, g, h, ...) \
+	((a) * 256U, (b) * 256U, (c) * 256U, (d) * 256U, (e) * 256U, (f) * 256U, (g) * 256U, (h) * 256U)
+#define BLIT_WIDE(...) BLIT_WIDE_(__VA_ARGS__, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0)
+#define BLIT_WIDE_(a, a2, b, b2, c, c2, d, d2, e, e2, f, f2, g, g2, h, h2, ...) \
+	((a) * 256U | (a2), (b) * 256U | (b2), (c) * 256U | (c2), (d) * 256U | (d2), \
+	(e) * 256U | (e2), (f) * 256U | (f2), (g) * 256U | (g2), (h) * 256U | (h2))
+
+// Column x of the rows, top row in bit 0, moved down offset rows
+#define BLIT_BIT(row, x, r) ((((row) >> (15 - (x))) & 1) << (r))
+#define BLIT_COLUMN(x, a, b, c, d, e, f, g, h) (BLIT_BIT(a, x, 0) | BLIT_BIT(b, x, 1) | BLIT_BIT(c, x, 2) \
+	| BLIT_BIT(d, x, 3) | BLIT_BIT(e, x, 4) | BLIT_BIT(f, x, 5) | BLIT_BIT(g, x, 6) | BLIT_BIT(h, x, 7))
+#define BLIT_COLUMN_(x, ...) BLIT_COLUMN(x, __VA_ARGS__)
+#define BLIT_UNPAREN(...) __VA_ARGS__
+#define BLIT_WORD(rows, x, offset) ((uint16_t)(BLIT_COLUMN_(x, BLIT_UNPAREN rows) << (offset)))
+
+// One offset's columns, for each sprite width in use
+#define BLIT_COLUMNS2(rows, o) BLIT_WORD(rows, 0, o), BLIT_WORD(rows, 1, o)
+#define BLIT_COLUMNS5(rows, o) BLIT_COLUMNS2(rows, o), BLIT_WORD(rows, 2, o), BLIT_WORD(rows, 3, o), \
+	BLIT_WORD(rows, 4, o)
+#define BLIT_COLUMNS10(rows, o) BLIT_COLUMNS5(rows, o), BLIT_WORD(rows, 5, o), BLIT_WORD(rows, 6, o), \
+	BLIT_WORD(rows, 7, o), BLIT_WORD(rows, 8, o), BLIT_WORD(rows, 9, o)
+
+#define BLIT_TABLE(columns, rows) \
+	{ columns(rows, 0) }, { columns(rows, 1) }, { columns(rows, 2) }, { columns(rows, 3) }, \
+	{ columns(rows, 4) }, { columns(rows, 5) }, { columns(rows, 6) }, { columns(rows, 7) }
+
+// draw_string() for a string in flash, e.g. PSTR("...")
+void draw_string_P(unsigned char x, unsigned char y, const char* string);
+
+// Draw a width x height sprite from its BLIT_TABLE() with its top-left at
+// (x, y), replacing whatever was in its box; it is clipped to the screen
+void blit(const uint16_t* table, unsigned char width, unsigned char height, int x, int y);
+
+#endif
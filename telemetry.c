@@ -0,0 +1,51 @@
+#include <string.h>
+
+#include "tx_queue.h"
+#include "telemetry.h"
+
+#define FRAME_MAX (4 + 1 + TELEMETRY_PAYLOAD_MAX)
+
+/*
+*	Consistent overhead byte stuffing: every zero is replaced by the
+*	distance to the next one, so 0x00 never appears inside a frame.
+*	out needs size + 1 bytes.
+*/
+static uint8_t cobs_encode(const uint8_t *in, uint8_t size, uint8_t *out){
+	uint8_t code_at = 0, code = 1, n = 1;
+
+	for (uint8_t i = 0; i < size; i++){
+		if (in[i] == 0){
+			out[code_at] = code;
+			code_at = n++;
+			code = 1;
+			continue;
+		}
+		out[n++] = in[i];
+		if (++code == 0xFF){
+			out[code_at] = code;
+			code_at = n++;
+			code = 1;
+		}
+	}
+	out[code_at] = code;
+	return n;
+}
+
+void telemetry_send(uint32_t tick, uint8_t event, const void *payload, uint8_t size){
+	// On the stack, so an interrupt can send in the middle of a main loop send
+	uint8_t frame[FRAME_MAX];
+	uint8_t encoded[FRAME_MAX + 2];
+
+	if (size > TELEMETRY_PAYLOAD_MAX) size = TELEMETRY_PAYLOAD_MAX;
+
+	frame[0] = tick;
+	frame[1] = tick >> 8;
+	frame[2] = tick >> 16;
+	frame[3] = tick >> 24;
+	frame[4] = event;
+	if (size) memcpy(&frame[5], payload, size);
+
+	uint8_t length = cobs_encode(frame, 5 + size, encoded);
+	encoded[length++] = 0;
+	tx_queue_write(encoded, length);
+}
@@ -0,0 +1,44 @@
+#ifndef telemetry_h__
+#define telemetry_h__
+
+/*
+*	Binary event stream for the debug serial port.
+*
+*	Each event is a u32 TIMER1 tick, a u8 event id and a small payload,
+*	COBS-encoded and terminated by a 0x00 byte so a reader can resync on
+*	any frame boundary. Payload fields are little-endian, as the AVR stores
+*	them. host/decode turns the stream back into the readable debug lines.
+*/
+
+#include <stdint.h>
+
+#define TELEMETRY_TICKS_PER_SECOND 7812.5	// TIMER1, F_CPU / 1024
+#define TELEMETRY_PAYLOAD_MAX 16
+
+// EVENT_INPUT's first byte: a 7-bit frame number, top bit set when the
+// frame begins with a game's seed record
+#define INPUT_SEQUENCE_MASK 0x7F
+#define INPUT_GAME_START 0x80
+
+enum {
+	EVENT_HELLO,			// no payload
+	EVENT_ALIEN_DESTROYED,		// no payload
+	EVENT_MOTHERSHIP_HIT_PLAYER,	// no payload
+	EVENT_ALIEN_HIT_PLAYER,		// no payload
+	EVENT_MOTHERSHIP_DESTROYED,	// no payload
+	EVENT_STATUS,			// int16 x, y, aim, fps
+	EVENT_COLLISION_PAIRS,		// uint32 tested, rejected
+	EVENT_SERIAL_DROPS,		// uint16 messages, bytes
+	EVENT_INPUT,			// uint8 sequence, then 1 to 15 input log bytes (input_log.h)
+	EVENT_GAME_OVER,		// uint32 steps, score
+	EVENT_PROFILE,			// uint8 phase, uint16 min/avg/max, uint8 percent[8] (profile.h)
+	EVENT_MEMORY,			// uint16 free SRAM bytes, stack headroom bytes (ram.h)
+	EVENT_ISR,			// uint8 isr, uint32 entries, uint16 longest (profile.h)
+	EVENT_LATENCY,			// uint16 presses, min/avg/max in TIMER4 ticks (debounce.h)
+	EVENT_COUNT
+};
+
+// frame and queue one event; safe from the main loop and from interrupts
+void telemetry_send(uint32_t tick, uint8_t event, const void *payload, uint8_t size);
+
+#endif
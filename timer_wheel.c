@@ -0,0 +1,94 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "timer_wheel.h"
+
+#define SLOT_MASK (TIMER_WHEEL_SLOTS - 1)
+#define TIMER_NONE 0xFF
+
+volatile uint16_t timer_ticks = 0;
+
+static uint16_t cursor;	// last tick timer_run() finished
+
+// Each slot heads a list of the timers expiring on a tick that maps to it
+static uint8_t slot_head[TIMER_WHEEL_SLOTS];
+static uint8_t timer_next[TIMER_COUNT];
+static uint8_t timer_slot[TIMER_COUNT];	// TIMER_NONE when idle
+static uint16_t timer_expires[TIMER_COUNT];
+static timer_callback timer_fn[TIMER_COUNT];
+static uint8_t timer_arg[TIMER_COUNT];
+
+static uint16_t ticks_now(void){
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t ticks = timer_ticks;
+	SREG = sreg;
+	return ticks;
+}
+
+void timer_init(void){
+	for (uint8_t i = 0; i < TIMER_WHEEL_SLOTS; i++) slot_head[i] = TIMER_NONE;
+	for (uint8_t i = 0; i < TIMER_COUNT; i++) timer_slot[i] = TIMER_NONE;
+	cursor = ticks_now();
+}
+
+void timer_cancel(uint8_t id){
+	if (timer_slot[id] == TIMER_NONE) return;
+
+	uint8_t *link = &slot_head[timer_slot[id]];
+	while (*link != id) link = &timer_next[*link];
+	*link = timer_next[id];
+	timer_slot[id] = TIMER_NONE;
+}
+
+void timer_start(uint8_t id, uint16_t delay, timer_callback fn, uint8_t arg){
+	timer_cancel(id);
+	if (delay == 0) delay = 1;
+
+	// Counted from the tick being processed, so timers restarted by their
+	// own callbacks keep exact periods even when timer_run() runs late
+	uint16_t expires = cursor + delay;
+	uint8_t slot = expires & SLOT_MASK;
+
+	timer_expires[id] = expires;
+	timer_fn[id] = fn;
+	timer_arg[id] = arg;
+	timer_slot[id] = slot;
+	timer_next[id] = slot_head[slot];
+	slot_head[slot] = id;
+}
+
+uint8_t timer_pending(uint8_t id){
+	return timer_slot[id] != TIMER_NONE;
+}
+
+uint16_t timer_elapsed(void){
+	return ticks_now() - cursor;
+}
+
+void timer_run(void){
+	timer_advance(timer_elapsed());
+}
+
+void timer_advance(uint16_t ticks){
+	while (ticks--){
+		cursor++;
+
+		// Timers more than a lap away share the slot; leave those be
+		uint8_t *link = &slot_head[cursor & SLOT_MASK];
+		while (*link != TIMER_NONE){
+			uint8_t id = *link;
+			if (timer_expires[id] != cursor){
+				link = &timer_next[id];
+				continue;
+			}
+
+			*link = timer_next[id];
+			timer_slot[id] = TIMER_NONE;
+			timer_fn[id](timer_arg[id]);
+
+			// The callback may have started or cancelled timers in this slot
+			link = &slot_head[cursor & SLOT_MASK];
+		}
+	}
+}
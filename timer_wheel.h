@@ -0,0 +1,51 @@
+#ifndef timer_wheel_h__
+#define timer_wheel_h__
+
+/*
+*	One-shot software timers on a hashed timing wheel.
+*
+*	An interrupt calls timer_tick() and does nothing else; the main loop
+*	calls timer_run() (or timer_advance()) to fire whatever has come due. Each tick only
+*	looks at one slot of the wheel, so the cost is O(1) per tick however
+*	far off the timers are. Timer ids are 0..TIMER_COUNT-1, assigned by
+*	the caller, and an id is either pending or idle.
+*/
+
+#include <stdint.h>
+
+// Set it for the whole build (-D) when the game needs more ids
+#ifndef TIMER_COUNT
+#define TIMER_COUNT 8
+#endif
+#define TIMER_WHEEL_SLOTS 64	// a power of two
+
+typedef void (*timer_callback)(uint8_t arg);
+
+extern volatile uint16_t timer_ticks;
+
+// the whole interrupt side
+static inline void timer_tick(void){
+	timer_ticks++;
+}
+
+// cancel everything and count from the current tick
+void timer_init(void);
+
+// (re)arm id to call fn(arg) in delay ticks (at most 65535)
+void timer_start(uint8_t id, uint16_t delay, timer_callback fn, uint8_t arg);
+
+void timer_cancel(uint8_t id);
+
+uint8_t timer_pending(uint8_t id);
+
+// fire timers that are due, oldest tick first; main loop only
+void timer_run(void);
+
+// ticks timer_run() would process now
+uint16_t timer_elapsed(void);
+
+// process the next ticks ticks whatever the interrupt has counted, so a
+// caller with its own clock (or a recording of one) can drive the wheel
+void timer_advance(uint16_t ticks);
+
+#endif
@@ -0,0 +1,55 @@
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "usb_serial.h"
+#include "tx_queue.h"
+
+#define TX_QUEUE_MASK (TX_QUEUE_SIZE - 1)
+
+static uint8_t ring[TX_QUEUE_SIZE];
+static volatile uint8_t head = 0;	// next byte written
+static volatile uint8_t tail = 0;	// next byte sent
+
+volatile uint16_t tx_queue_overflows = 0;
+volatile uint16_t tx_queue_dropped = 0;
+
+uint8_t tx_queue_used(void){
+	return (head - tail) & TX_QUEUE_MASK;
+}
+
+int8_t tx_queue_write(const uint8_t *buffer, uint8_t size){
+	uint8_t sreg = SREG;
+	cli();
+
+	// One slot stays empty so a full ring isn't mistaken for an empty one
+	if (size > TX_QUEUE_MASK - tx_queue_used()){
+		tx_queue_overflows++;
+		tx_queue_dropped += size;
+		SREG = sreg;
+		return -1;
+	}
+
+	uint8_t h = head;
+	while (size--){
+		ring[h] = *buffer++;
+		h = (h + 1) & TX_QUEUE_MASK;
+	}
+	head = h;
+
+	SREG = sreg;
+	return 0;
+}
+
+void tx_queue_drain(uint8_t max){
+	uint8_t used = tx_queue_used();
+	if (!used) return;
+
+	// usb_serial_write() wants contiguous bytes, so stop at the end of the ring
+	uint8_t size = TX_QUEUE_SIZE - tail;
+	if (size > used) size = used;
+	if (size > max) size = max;
+
+	if (usb_serial_write(&ring[tail], size) == 0){
+		tail = (tail + size) & TX_QUEUE_MASK;
+	}
+}
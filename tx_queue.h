@@ -0,0 +1,30 @@
+#ifndef tx_queue_h__
+#define tx_queue_h__
+
+/*
+*	Non-blocking transmit queue in front of the USB serial port.
+*
+*	Producers in the main loop or in interrupts copy whole messages into a
+*	RAM ring and return at once; a message that doesn't fit is dropped and
+*	counted rather than waited on. The USB start-of-frame interrupt drains
+*	the ring through usb_serial_write(), at most one packet per frame.
+*/
+
+#include <stdint.h>
+
+#define TX_QUEUE_SIZE 128	// bytes, a power of two
+
+// queue a message; 0 on success, -1 if it was dropped for lack of room
+int8_t tx_queue_write(const uint8_t *buffer, uint8_t size);
+
+// hand up to max queued bytes to usb_serial_write(); call from the SOF interrupt
+void tx_queue_drain(uint8_t max);
+
+// bytes waiting to be sent
+uint8_t tx_queue_used(void);
+
+// messages and bytes dropped because the queue was full
+extern volatile uint16_t tx_queue_overflows;
+extern volatile uint16_t tx_queue_dropped;
+
+#endif
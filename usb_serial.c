@@ -32,6 +32,8 @@
 
 #define USB_SERIAL_PRIVATE_INCLUDE
 #include "usb_serial.h"
+#include "tx_queue.h"
+#include "profile.h"
 
 
 /**************************************************************************
@@ -719,6 +721,7 @@ int8_t usb_serial_set_control(uint8_t signals)
 ISR(USB_GEN_vect)
 {
 	uint8_t intbits, t;
+	PROFILE_ISR_ENTER();
 
         intbits = UDINT;
         UDINT = 0;
@@ -733,6 +736,10 @@ ISR(USB_GEN_vect)
         }
 	if (intbits & (1<<SOFI)) {
 		if (usb_configuration) {
+			// drain the transmit queue into whatever room the bank has,
+			// so usb_serial_write() never waits inside this interrupt
+			UENUM = CDC_TX_ENDPOINT;
+			if (UEINTX & (1<<RWAL)) tx_queue_drain(CDC_TX_SIZE - UEBCLX);
 			t = transmit_flush_timer;
 			if (t) {
 				transmit_flush_timer = --t;
@@ -743,6 +750,7 @@ ISR(USB_GEN_vect)
 			}
 		}
 	}
+	PROFILE_ISR_EXIT(ISR_USB_GEN);
 }
 
 
@@ -770,7 +778,9 @@ static inline void usb_ack_out(void)
 // other endpoints are manipulated by the user-callable
 // functions, and the start-of-frame interrupt.
 //
-ISR(USB_COM_vect)
+// The handler body returns from many places, so it lives in
+// usb_endpoint0() and the interrupt just wraps it for the profiler.
+static inline void usb_endpoint0(void)
 {
         uint8_t intbits;
 	const uint8_t *list;
@@ -933,4 +943,11 @@ ISR(USB_COM_vect)
 	UECONX = (1<<STALLRQ) | (1<<EPEN);	// stall
 }
 
+ISR(USB_COM_vect)
+{
+	PROFILE_ISR_ENTER();
+	usb_endpoint0();
+	PROFILE_ISR_EXIT(ISR_USB_COM);
+}
+
 